@@ -30,6 +30,7 @@
 #include <nucleus/DataQuerier.h>
 #include <nucleus/camera/Controller.h>
 #include <nucleus/camera/PositionStorage.h>
+#include <nucleus/map_label/Declutter.h>
 #include <nucleus/map_label/Filter.h>
 #include <nucleus/map_label/setup.h>
 #include <nucleus/picker/PickerManager.h>
@@ -58,6 +59,7 @@ struct RenderingContext::Data {
     std::shared_ptr<nucleus::DataQuerier> data_querier;
     std::unique_ptr<nucleus::camera::Controller> camera_controller;
     std::shared_ptr<nucleus::map_label::Filter> label_filter;
+    std::shared_ptr<nucleus::map_label::Declutter> label_declutter;
     std::shared_ptr<nucleus::picker::PickerManager> picker_manager;
     std::shared_ptr<nucleus::tile::utils::AabbDecorator> aabb_decorator;
     std::unique_ptr<nucleus::tile::SchedulerDirector> scheduler_director;
@@ -106,9 +108,11 @@ RenderingContext::RenderingContext(QObject* parent)
 
     m->picker_manager = std::make_shared<PickerManager>();
     m->label_filter = std::make_shared<Filter>();
+    m->label_declutter = std::make_shared<Declutter>();
     if (m->scheduler_thread) {
         m->picker_manager->moveToThread(m->scheduler_thread.get());
         m->label_filter->moveToThread(m->scheduler_thread.get());
+        m->label_declutter->moveToThread(m->scheduler_thread.get());
     }
     // clang-format off
     connect(m->geometry.scheduler.get(),       &nucleus::tile::GeometryScheduler::gpu_tiles_updated, RenderThreadNotifier::instance(), &RenderThreadNotifier::notify);
@@ -116,6 +120,7 @@ RenderingContext::RenderingContext(QObject* parent)
     connect(m->map_label.scheduler.get(),      &nucleus::map_label::Scheduler::gpu_tiles_updated,    RenderThreadNotifier::instance(), &RenderThreadNotifier::notify);
     connect(m->map_label.scheduler.get(),      &nucleus::map_label::Scheduler::gpu_tiles_updated,    m->picker_manager.get(),          &PickerManager::update_quads);
     connect(m->map_label.scheduler.get(),      &nucleus::map_label::Scheduler::gpu_tiles_updated,    m->label_filter.get(),            &Filter::update_quads);
+    connect(m->label_filter.get(),             &Filter::filter_finished,                             m->label_declutter.get(),         &Declutter::update_quads);
     // clang-format on
 
     if (QNetworkInformation::loadDefaultBackend() && QNetworkInformation::instance()) {
@@ -171,7 +176,7 @@ void RenderingContext::initialise()
 
     // labels
     m->engine_context->set_map_label_manager(std::make_unique<gl_engine::MapLabels>(m->aabb_decorator));
-    connect(m->label_filter.get(), &Filter::filter_finished, m->engine_context->map_label_manager(), &gl_engine::MapLabels::update_labels);
+    connect(m->label_declutter.get(), &Declutter::declutter_finished, m->engine_context->map_label_manager(), &gl_engine::MapLabels::update_labels);
     nucleus::utils::thread::async_call(m->map_label.scheduler.get(), [this]() { m->map_label.scheduler->set_enabled(true); });
 
     // clang-format off
@@ -197,6 +202,7 @@ void RenderingContext::destroy()
             m->geometry.scheduler.reset();
             m->camera_controller.reset();
             m->label_filter.reset();
+            m->label_declutter.reset();
             m->picker_manager.reset();
             m->map_label.scheduler.reset();
             m->ortho_texture.scheduler.reset();
@@ -249,6 +255,12 @@ std::shared_ptr<nucleus::map_label::Filter> RenderingContext::label_filter() con
     return m->label_filter;
 }
 
+std::shared_ptr<nucleus::map_label::Declutter> RenderingContext::label_declutter() const
+{
+    QMutexLocker locker(&m->shared_ptr_mutex);
+    return m->label_declutter;
+}
+
 nucleus::map_label::Scheduler* RenderingContext::map_label_scheduler() const
 {
     QMutexLocker locker(&m->shared_ptr_mutex);
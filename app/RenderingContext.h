@@ -30,6 +30,7 @@ class DataQuerier;
 }
 namespace nucleus::map_label {
 class Filter;
+class Declutter;
 }
 namespace nucleus::map_label {
 class Scheduler;
@@ -75,6 +76,7 @@ public:
     [[nodiscard]] nucleus::tile::GeometryScheduler* geometry_scheduler() const;
     [[nodiscard]] std::shared_ptr<nucleus::picker::PickerManager> picker_manager() const;
     [[nodiscard]] std::shared_ptr<nucleus::map_label::Filter> label_filter() const;
+    [[nodiscard]] std::shared_ptr<nucleus::map_label::Declutter> label_declutter() const;
     [[nodiscard]] nucleus::map_label::Scheduler* map_label_scheduler() const;
     [[nodiscard]] nucleus::tile::TextureScheduler* ortho_scheduler() const;
     [[nodiscard]] nucleus::tile::SchedulerDirector* scheduler_director() const;
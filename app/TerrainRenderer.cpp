@@ -32,7 +32,7 @@
 #include <nucleus/EngineContext.h>
 #include <nucleus/camera/Controller.h>
 #include <nucleus/camera/PositionStorage.h>
-#include <nucleus/map_label/Filter.h>
+#include <nucleus/map_label/Declutter.h>
 #include <nucleus/map_label/Scheduler.h>
 #include <nucleus/picker/PickerManager.h>
 #include <nucleus/tile/GeometryScheduler.h>
@@ -41,7 +41,7 @@
 
 TerrainRenderer::TerrainRenderer()
 {
-    using nucleus::map_label::Filter;
+    using nucleus::map_label::Declutter;
     using nucleus::picker::PickerManager;
     using Scheduler = nucleus::tile::Scheduler;
     using CameraController = nucleus::camera::Controller;
@@ -62,11 +62,12 @@ TerrainRenderer::TerrainRenderer()
     connect(m_camera_controller.get(), &CameraController::definition_changed, ctx->geometry_scheduler(),   &Scheduler::update_camera);
     connect(m_camera_controller.get(), &CameraController::definition_changed, ctx->map_label_scheduler(),  &Scheduler::update_camera);
     connect(m_camera_controller.get(), &CameraController::definition_changed, ctx->ortho_scheduler(),      &Scheduler::update_camera);
+    connect(m_camera_controller.get(), &CameraController::definition_changed, ctx->label_declutter().get(), &Declutter::update_camera);
     connect(m_camera_controller.get(), &CameraController::definition_changed, m_glWindow.get(),            &gl_engine::Window::update_camera);
 
     connect(ctx->geometry_scheduler(), &nucleus::tile::GeometryScheduler::gpu_tiles_updated, gl_window_ptr, &gl_engine::Window::update_requested);
     connect(ctx->ortho_scheduler(),    &nucleus::tile::TextureScheduler::gpu_tiles_updated,  gl_window_ptr, &gl_engine::Window::update_requested);
-    connect(ctx->label_filter().get(), &Filter::filter_finished,                             gl_window_ptr, &gl_engine::Window::update_requested);
+    connect(ctx->label_declutter().get(), &Declutter::declutter_finished,                    gl_window_ptr, &gl_engine::Window::update_requested);
 
     connect(ctx->picker_manager().get(),   &PickerManager::pick_requested,     gl_window_ptr,                  &gl_engine::Window::pick_value);
     connect(gl_window_ptr,                 &gl_engine::Window::value_picked,   ctx->picker_manager().get(),    &PickerManager::eval_pick);
@@ -57,7 +57,7 @@ void MapLabels::init(ShaderRegistry* shader_registry)
         nucleus::map_label::FontRenderer::m_font_atlas_size.width(), nucleus::map_label::FontRenderer::m_font_atlas_size.height(), nucleus::map_label::FontRenderer::m_max_textures);
     for(unsigned int i = 0; i < atlas_data.font_atlas.size(); i++)
     {
-        m_font_texture->upload(atlas_data.font_atlas[i],i);
+        m_font_texture->upload(atlas_data.font_atlas[i], atlas_data.page_indices[i]);
     }
 
     const auto& labelIcons = m_mapLabelFactory.label_icons();
@@ -79,8 +79,9 @@ MapLabels::TileSet MapLabels::generate_draw_list(const nucleus::camera::Definiti
     return m_draw_list_generator.cull(m_draw_list_generator.generate_for(camera, 256, 18), camera.frustum());
 }
 
-void MapLabels::upload_to_gpu(const TileId& id, const PointOfInterestCollection& features)
+void MapLabels::upload_to_gpu(const nucleus::vector_tile::PoiTile& tile)
 {
+    const auto& id = tile.id;
     if (!QOpenGLContext::currentContext()) // can happen during shutdown.
         return;
 
@@ -91,10 +92,12 @@ void MapLabels::upload_to_gpu(const TileId& id, const PointOfInterestCollection&
     vectortile->vao->create();
     vectortile->vao->bind();
 
-    const auto [allLabels, reference_point, atlas_data] = m_mapLabelFactory.create_labels(features);
+    const auto [allLabels, reference_point, atlas_data]
+        = tile.visible ? m_mapLabelFactory.create_labels(*tile.data, *tile.visible) : m_mapLabelFactory.create_labels(*tile.data);
     if (atlas_data.changed) {
+        // only pages with new glyphs
         for (unsigned int i = 0; i < atlas_data.font_atlas.size(); i++) {
-            m_font_texture->upload(atlas_data.font_atlas[i], i);
+            m_font_texture->upload(atlas_data.font_atlas[i], atlas_data.page_indices[i]);
         }
     }
     vectortile->reference_point = reference_point;
@@ -155,7 +158,7 @@ void MapLabels::update_labels(const std::vector<PoiTile>& updated_tiles, const s
         // since we are renewing the tile we remove it first to delete allocations like vao
         remove_tile(vectortile.id);
 
-        upload_to_gpu(vectortile.id, *vectortile.data);
+        upload_to_gpu(vectortile);
         m_draw_list_generator.add_tile(vectortile.id);
     }
 }
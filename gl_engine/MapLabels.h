@@ -64,7 +64,7 @@ public:
     unsigned int tile_count() const;
 
 private:
-    void upload_to_gpu(const TileId& id, const PointOfInterestCollection& features);
+    void upload_to_gpu(const nucleus::vector_tile::PoiTile& tile);
     void remove_tile(const TileId& tile_id);
 
     std::shared_ptr<ShaderProgram> m_label_shader;
@@ -21,10 +21,12 @@
 #include <nucleus/tile/cache_quieries.h>
 
 nucleus::DataQuerier::DataQuerier(tile::MemoryCache* cache)
-    : m_memory_cache(cache)
+    : m_height_sampler(cache)
 {}
 
-tl::expected<float, QString> nucleus::DataQuerier::get_altitude(const glm::dvec2& lat_long) const
+tl::expected<float, QString> nucleus::DataQuerier::get_altitude(const glm::dvec2& lat_long) const { return get_altitudes(std::span(&lat_long, 1)).front(); }
+
+std::vector<tl::expected<float, QString>> nucleus::DataQuerier::get_altitudes(std::span<const glm::dvec2> lat_longs) const
 {
-    return tile::cache_queries::query_altitude(m_memory_cache, lat_long);
+    return tile::cache_queries::query_altitudes(m_height_sampler, lat_longs);
 }
@@ -19,19 +19,24 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <span>
 
+#include <nucleus/HeightSampler.h>
 #include <nucleus/tile/Cache.h>
 
 namespace nucleus {
 
 class DataQuerier
 {
-    tile::MemoryCache* m_memory_cache = nullptr;
+    HeightSampler m_height_sampler;
 
 public:
     DataQuerier(tile::MemoryCache* cache);
 
     [[nodiscard]] tl::expected<float, QString> get_altitude(const glm::dvec2& lat_long) const;
+    /// batched version, decodes every height tile only once. prefer this over get_altitude for more than a few points.
+    [[nodiscard]] std::vector<tl::expected<float, QString>> get_altitudes(std::span<const glm::dvec2> lat_longs) const;
+    [[nodiscard]] const HeightSampler& height_sampler() const { return m_height_sampler; }
 };
 
 } // namespace nucleus
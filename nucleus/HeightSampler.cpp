@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "HeightSampler.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <nucleus/srs.h>
+#include <nucleus/tile/cache_quieries.h>
+#include <nucleus/utils/image_loader.h>
+#include <radix/height_encoding.h>
+
+using namespace nucleus;
+
+namespace {
+// the 16 bit height representation (red << 8 | green) maps linearly to metres. interpolating the raw values and converting once afterwards
+// keeps the inner loop free of the per texel decoding.
+struct HeightScale {
+    float offset = radix::height_encoding::to_float(glm::u8vec3(0, 0, 0));
+    float scale = (radix::height_encoding::to_float(glm::u8vec3(255, 255, 0)) - offset) / 65535.f;
+};
+const HeightScale height_scale = {};
+} // namespace
+
+HeightSampler::HeightSampler(tile::MemoryCache* cache, uint64_t byte_limit)
+    : m_memory_cache(cache)
+    , m_pyramid(byte_limit)
+{
+}
+
+void HeightSampler::interpolate(const Raster<uint16_t>& heights, std::span<const glm::vec2> positions, std::span<float> altitudes)
+{
+    assert(positions.size() == altitudes.size());
+    assert(heights.width() > 0 && heights.height() > 0);
+    const auto max_x = float(heights.width() - 1);
+    const auto max_y = float(heights.height() - 1);
+    const auto width = heights.width();
+    const auto* data = heights.buffer().data();
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const auto x = std::clamp(positions[i].x, 0.f, max_x);
+        const auto y = std::clamp(positions[i].y, 0.f, max_y);
+        const auto x0 = std::min(unsigned(x), width - 1);
+        const auto y0 = std::min(unsigned(y), heights.height() - 1);
+        const auto x1 = std::min(x0 + 1, width - 1);
+        const auto y1 = std::min(y0 + 1, heights.height() - 1);
+        const auto fx = x - float(x0);
+        const auto fy = y - float(y0);
+
+        const auto top = float(data[y0 * width + x0]) * (1 - fx) + float(data[y0 * width + x1]) * fx;
+        const auto bottom = float(data[y1 * width + x0]) * (1 - fx) + float(data[y1 * width + x1]) * fx;
+        altitudes[i] = height_scale.offset + (top * (1 - fy) + bottom * fy) * height_scale.scale;
+    }
+}
+
+std::vector<std::optional<HeightSampler::Sample>> HeightSampler::sample(std::span<const glm::dvec2> lat_longs, unsigned max_zoom_level) const
+{
+    std::vector<glm::dvec2> world_space_points;
+    world_space_points.reserve(lat_longs.size());
+    for (const auto& lat_long : lat_longs)
+        world_space_points.push_back(srs::lat_long_to_world(lat_long));
+
+    const auto tiles = tile::cache_queries::finest_tiles(m_memory_cache, world_space_points, max_zoom_level);
+
+    // group the points by tile, so that every tile is looked up once and the interpolation runs over contiguous arrays
+    std::unordered_map<tile::Id, std::vector<size_t>, tile::Id::Hasher> groups;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (tiles[i].data && tiles[i].data->size())
+            groups[tiles[i].id].push_back(i);
+    }
+
+    std::vector<std::optional<Sample>> samples(lat_longs.size());
+    std::vector<glm::vec2> positions;
+    std::vector<float> altitudes;
+    for (const auto& [id, indices] : groups) {
+        const auto& tile = tiles[indices.front()];
+        auto heights = [&] {
+            std::scoped_lock lock(m_mutex);
+            return m_pyramid.get(id, tile.network_info.timestamp);
+        }();
+        if (!heights) {
+            // decoding runs unlocked. concurrent misses on the same tile decode twice, which is cheaper than serialising all queries.
+            auto decoded = nucleus::utils::image_loader::rg8_as_u16(*tile.data);
+            if (!decoded || decoded->width() == 0 || decoded->height() == 0)
+                continue;
+            heights = std::make_shared<const Raster<uint16_t>>(std::move(decoded.value()));
+            std::scoped_lock lock(m_mutex);
+            m_pyramid.put(id, tile.network_info.timestamp, heights, heights->size_in_bytes());
+        }
+
+        // samples are on the tile border, as for the terrain mesh
+        const auto bounds = srs::tile_bounds(id);
+        const auto size = glm::dvec2(heights->width() - 1, heights->height() - 1);
+        positions.resize(indices.size());
+        altitudes.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            const auto uv = (world_space_points[indices[i]] - bounds.min) / bounds.size();
+            positions[i] = glm::vec2(glm::dvec2(uv.x, 1 - uv.y) * size);
+        }
+        interpolate(*heights, positions, altitudes);
+        for (size_t i = 0; i < indices.size(); ++i)
+            samples[indices[i]] = Sample { altitudes[i], id.zoom_level };
+    }
+    return samples;
+}
+
+std::optional<HeightSampler::Sample> HeightSampler::sample(const glm::dvec2& lat_long, unsigned max_zoom_level) const { return sample(std::span(&lat_long, 1), max_zoom_level).front(); }
+
+size_t HeightSampler::n_decoded_tiles() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_pyramid.size();
+}
+
+uint64_t HeightSampler::n_decoded_bytes() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_pyramid.n_bytes();
+}
+
+void HeightSampler::clear()
+{
+    std::scoped_lock lock(m_mutex);
+    m_pyramid.clear();
+}
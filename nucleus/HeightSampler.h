@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <nucleus/Raster.h>
+#include <nucleus/tile/Cache.h>
+#include <nucleus/tile/DecodedTileCache.h>
+
+namespace nucleus {
+
+/// Bilinear terrain height samples from the tiles in the geometry ram cache.
+/// Decoded height tiles of all zoom levels are kept in a byte bounded pyramid (LRU), so repeated queries in the same area don't decode again.
+/// Thread safe.
+class HeightSampler {
+public:
+    struct Sample {
+        float altitude = 0;
+        unsigned zoom_level = 0; // zoom level of the tile that was sampled
+    };
+
+    explicit HeightSampler(tile::MemoryCache* cache, uint64_t byte_limit = 32u * 1024u * 1024u);
+
+    /// samples the finest available tile with a zoom level up to max_zoom_level. empty if no such tile covers the point.
+    [[nodiscard]] std::vector<std::optional<Sample>> sample(std::span<const glm::dvec2> lat_longs, unsigned max_zoom_level = std::numeric_limits<unsigned>::max()) const;
+    [[nodiscard]] std::optional<Sample> sample(const glm::dvec2& lat_long, unsigned max_zoom_level = std::numeric_limits<unsigned>::max()) const;
+
+    /// bilinear interpolation of the height samples at positions given in pixel coordinates. positions are clamped to the raster.
+    static void interpolate(const Raster<uint16_t>& heights, std::span<const glm::vec2> positions, std::span<float> altitudes);
+
+    [[nodiscard]] size_t n_decoded_tiles() const;
+    [[nodiscard]] uint64_t n_decoded_bytes() const;
+    void clear();
+
+private:
+    tile::MemoryCache* m_memory_cache = nullptr;
+    mutable std::mutex m_mutex;
+    mutable tile::DecodedTileCache<std::shared_ptr<const Raster<uint16_t>>> m_pyramid;
+};
+
+} // namespace nucleus
@@ -0,0 +1,232 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "Raster.h"
+
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+// also taken by emscripten, which translates sse2 to wasm simd (-msse2 -msimd128)
+#define ALP_RASTER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ALP_RASTER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace nucleus::detail {
+
+namespace {
+    void assert_sizes([[maybe_unused]] const glm::uvec2& src, [[maybe_unused]] const glm::uvec2& dst)
+    {
+        assert(dst.x * 2 <= src.x);
+        assert(dst.y * 2 <= src.y);
+    }
+
+    const std::array<float, 256>& srgb_to_linear_table()
+    {
+        static const auto table = []() {
+            std::array<float, 256> t {};
+            for (unsigned i = 0; i < t.size(); ++i) {
+                const auto c = float(i) / 255.0f;
+                t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    constexpr unsigned linear_table_size = 4096;
+    const std::array<uint8_t, linear_table_size>& linear_to_srgb_table()
+    {
+        static const auto table = []() {
+            std::array<uint8_t, linear_table_size> t {};
+            for (unsigned i = 0; i < t.size(); ++i) {
+                const auto l = float(i) / float(linear_table_size - 1);
+                const auto c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                t[i] = uint8_t(std::lround(glm::clamp(c, 0.0f, 1.0f) * 255.0f));
+            }
+            return t;
+        }();
+        return table;
+    }
+} // namespace
+
+void downsample(const Raster<glm::u8vec4>& src, Raster<glm::u8vec4>& dst)
+{
+    assert_sizes(src.size(), dst.size());
+    const auto width = dst.width();
+    for (unsigned j = 0; j < dst.height(); ++j) {
+        const auto* row0 = reinterpret_cast<const uint8_t*>(src.data() + size_t(j) * 2 * src.width());
+        const auto* row1 = row0 + size_t(src.width()) * 4;
+        auto* out = reinterpret_cast<uint8_t*>(dst.data() + size_t(j) * width);
+        unsigned i = 0;
+#if defined(ALP_RASTER_SSE2)
+        // 4 output pixels per iteration. channels are widened to 16 bit, two pixels per register.
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= width; i += 4) {
+            const auto* a = reinterpret_cast<const __m128i*>(row0 + size_t(i) * 8);
+            const auto* b = reinterpret_cast<const __m128i*>(row1 + size_t(i) * 8);
+            const __m128i a0 = _mm_loadu_si128(a);
+            const __m128i a1 = _mm_loadu_si128(a + 1);
+            const __m128i b0 = _mm_loadu_si128(b);
+            const __m128i b1 = _mm_loadu_si128(b + 1);
+            const __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            const __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            const __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            const __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            // the low half holds the sum of both pixels
+            const __m128i h0 = _mm_add_epi16(v0, _mm_srli_si128(v0, 8));
+            const __m128i h1 = _mm_add_epi16(v1, _mm_srli_si128(v1, 8));
+            const __m128i h2 = _mm_add_epi16(v2, _mm_srli_si128(v2, 8));
+            const __m128i h3 = _mm_add_epi16(v3, _mm_srli_si128(v3, 8));
+            const __m128i r01 = _mm_srli_epi16(_mm_unpacklo_epi64(h0, h1), 2);
+            const __m128i r23 = _mm_srli_epi16(_mm_unpacklo_epi64(h2, h3), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + size_t(i) * 4), _mm_packus_epi16(r01, r23));
+        }
+#elif defined(ALP_RASTER_NEON)
+        for (; i + 4 <= width; i += 4) {
+            const auto* a = row0 + size_t(i) * 8;
+            const auto* b = row1 + size_t(i) * 8;
+            const uint8x16_t a0 = vld1q_u8(a);
+            const uint8x16_t a1 = vld1q_u8(a + 16);
+            const uint8x16_t b0 = vld1q_u8(b);
+            const uint8x16_t b1 = vld1q_u8(b + 16);
+            const uint16x8_t v0 = vaddl_u8(vget_low_u8(a0), vget_low_u8(b0));
+            const uint16x8_t v1 = vaddl_u8(vget_high_u8(a0), vget_high_u8(b0));
+            const uint16x8_t v2 = vaddl_u8(vget_low_u8(a1), vget_low_u8(b1));
+            const uint16x8_t v3 = vaddl_u8(vget_high_u8(a1), vget_high_u8(b1));
+            const uint16x4_t h0 = vadd_u16(vget_low_u16(v0), vget_high_u16(v0));
+            const uint16x4_t h1 = vadd_u16(vget_low_u16(v1), vget_high_u16(v1));
+            const uint16x4_t h2 = vadd_u16(vget_low_u16(v2), vget_high_u16(v2));
+            const uint16x4_t h3 = vadd_u16(vget_low_u16(v3), vget_high_u16(v3));
+            vst1q_u8(out + size_t(i) * 4, vcombine_u8(vshrn_n_u16(vcombine_u16(h0, h1), 2), vshrn_n_u16(vcombine_u16(h2, h3), 2)));
+        }
+#endif
+        for (; i < width; ++i) {
+            for (unsigned c = 0; c < 4; ++c) {
+                const auto sum = unsigned(row0[i * 8 + c]) + row0[i * 8 + 4 + c] + row1[i * 8 + c] + row1[i * 8 + 4 + c];
+                out[i * 4 + c] = uint8_t(sum / 4);
+            }
+        }
+    }
+}
+
+void downsample(const Raster<uint16_t>& src, Raster<uint16_t>& dst)
+{
+    assert_sizes(src.size(), dst.size());
+    const auto width = dst.width();
+    for (unsigned j = 0; j < dst.height(); ++j) {
+        const auto* row0 = src.data() + size_t(j) * 2 * src.width();
+        const auto* row1 = row0 + src.width();
+        auto* out = dst.data() + size_t(j) * width;
+        unsigned i = 0;
+#if defined(ALP_RASTER_SSE2)
+        // 8 output pixels per iteration, summed in 32 bit
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias32 = _mm_set1_epi32(0x8000);
+        const __m128i bias16 = _mm_set1_epi16(int16_t(0x8000));
+        for (; i + 8 <= width; i += 8) {
+            const auto* a = reinterpret_cast<const __m128i*>(row0 + size_t(i) * 2);
+            const auto* b = reinterpret_cast<const __m128i*>(row1 + size_t(i) * 2);
+            const __m128i a0 = _mm_loadu_si128(a);
+            const __m128i a1 = _mm_loadu_si128(a + 1);
+            const __m128i b0 = _mm_loadu_si128(b);
+            const __m128i b1 = _mm_loadu_si128(b + 1);
+            const __m128i v0 = _mm_add_epi32(_mm_unpacklo_epi16(a0, zero), _mm_unpacklo_epi16(b0, zero));
+            const __m128i v1 = _mm_add_epi32(_mm_unpackhi_epi16(a0, zero), _mm_unpackhi_epi16(b0, zero));
+            const __m128i v2 = _mm_add_epi32(_mm_unpacklo_epi16(a1, zero), _mm_unpacklo_epi16(b1, zero));
+            const __m128i v3 = _mm_add_epi32(_mm_unpackhi_epi16(a1, zero), _mm_unpackhi_epi16(b1, zero));
+            const auto pair_sum = [](__m128i lo, __m128i hi) {
+                const __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+                return _mm_srli_epi32(_mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd)), 2);
+            };
+            // sse2 has no unsigned 32 -> 16 bit pack, so the values are shifted into the signed range and back
+            const __m128i r0 = _mm_sub_epi32(pair_sum(v0, v1), bias32);
+            const __m128i r1 = _mm_sub_epi32(pair_sum(v2, v3), bias32);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi16(_mm_packs_epi32(r0, r1), bias16));
+        }
+#elif defined(ALP_RASTER_NEON)
+        for (; i + 4 <= width; i += 4) {
+            const uint32x4_t sum = vpadalq_u16(vpaddlq_u16(vld1q_u16(row0 + size_t(i) * 2)), vld1q_u16(row1 + size_t(i) * 2));
+            vst1_u16(out + i, vshrn_n_u32(sum, 2));
+        }
+#endif
+        for (; i < width; ++i)
+            out[i] = uint16_t((unsigned(row0[i * 2]) + row0[i * 2 + 1] + row1[i * 2] + row1[i * 2 + 1]) / 4);
+    }
+}
+
+void downsample(const Raster<float>& src, Raster<float>& dst)
+{
+    assert_sizes(src.size(), dst.size());
+    const auto width = dst.width();
+    for (unsigned j = 0; j < dst.height(); ++j) {
+        const auto* row0 = src.data() + size_t(j) * 2 * src.width();
+        const auto* row1 = row0 + src.width();
+        auto* out = dst.data() + size_t(j) * width;
+        unsigned i = 0;
+#if defined(ALP_RASTER_SSE2)
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        for (; i + 4 <= width; i += 4) {
+            const __m128 v0 = _mm_add_ps(_mm_loadu_ps(row0 + size_t(i) * 2), _mm_loadu_ps(row1 + size_t(i) * 2));
+            const __m128 v1 = _mm_add_ps(_mm_loadu_ps(row0 + size_t(i) * 2 + 4), _mm_loadu_ps(row1 + size_t(i) * 2 + 4));
+            const __m128 even = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 odd = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(even, odd), quarter));
+        }
+#elif defined(ALP_RASTER_NEON)
+        for (; i + 4 <= width; i += 4) {
+            const float32x4x2_t a = vld2q_f32(row0 + size_t(i) * 2);
+            const float32x4x2_t b = vld2q_f32(row1 + size_t(i) * 2);
+            const float32x4_t sum = vaddq_f32(vaddq_f32(a.val[0], b.val[0]), vaddq_f32(a.val[1], b.val[1]));
+            vst1q_f32(out + i, vmulq_n_f32(sum, 0.25f));
+        }
+#endif
+        // same summation order as the vectorised code
+        for (; i < width; ++i)
+            out[i] = ((row0[i * 2] + row1[i * 2]) + (row0[i * 2 + 1] + row1[i * 2 + 1])) * 0.25f;
+    }
+}
+
+void downsample_srgb(const Raster<glm::u8vec4>& src, Raster<glm::u8vec4>& dst)
+{
+    assert_sizes(src.size(), dst.size());
+    const auto& to_linear = srgb_to_linear_table();
+    const auto& to_srgb = linear_to_srgb_table();
+    for (unsigned j = 0; j < dst.height(); ++j) {
+        const auto* row0 = src.data() + size_t(j) * 2 * src.width();
+        const auto* row1 = row0 + src.width();
+        auto* out = dst.data() + size_t(j) * dst.width();
+        for (unsigned i = 0; i < dst.width(); ++i) {
+            const auto& a = row0[i * 2];
+            const auto& b = row0[i * 2 + 1];
+            const auto& c = row1[i * 2];
+            const auto& d = row1[i * 2 + 1];
+            for (unsigned k = 0; k < 3; ++k) {
+                const auto linear = (to_linear[a[k]] + to_linear[b[k]] + to_linear[c[k]] + to_linear[d[k]]) * 0.25f;
+                out[i][k] = to_srgb[unsigned(linear * float(linear_table_size - 1) + 0.5f)];
+            }
+            out[i].a = uint8_t((unsigned(a.a) + b.a + c.a + d.a) / 4);
+        }
+    }
+}
+
+} // namespace nucleus::detail
@@ -25,19 +25,25 @@
 #include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtx/component_wise.hpp>
+#include <nucleus/RasterAllocator.h>
+#include <type_traits>
 #include <vector>
 
 namespace nucleus {
 
-template <typename T>
+template <typename T, typename Allocator = DefaultRasterAllocator<T>>
 class Raster {
-    std::vector<T> m_data;
+public:
+    using Container = std::vector<T, Allocator>;
+
+private:
+    Container m_data;
     unsigned m_width = 0;
     unsigned m_height = 0;
 
 public:
     Raster() = default;
-    Raster(unsigned square_side_length, std::vector<T>&& vector)
+    Raster(unsigned square_side_length, Container&& vector)
         : m_data(std::move(vector))
         , m_width(square_side_length)
         , m_height(square_side_length)
@@ -45,26 +51,38 @@ public:
         assert(m_data.size() == m_width * m_height);
     }
     Raster(unsigned square_side_length)
-        : m_data(square_side_length * square_side_length)
+        : m_data(size_t(square_side_length) * square_side_length, T {})
         , m_width(square_side_length)
         , m_height(square_side_length)
     {
     }
     Raster(const glm::uvec2& size)
-        : m_data(size.x * size.y)
+        : m_data(size_t(size.x) * size.y, T {})
         , m_width(size.x)
         , m_height(size.y)
     {
     }
+    /// takes ownership of buffer without copying. it must hold size.x * size.y pixels.
+    Raster(const glm::uvec2& size, raster_memory::UniqueBuffer<T>&& buffer)
+        requires std::is_same_v<Allocator, RasterAllocator<T>>
+        : m_data(size_t(size.x) * size.y, size.x && size.y ? Allocator(buffer.get(), size_t(size.x) * size.y) : Allocator())
+        , m_width(size.x)
+        , m_height(size.y)
+    {
+        static_assert(std::is_trivially_default_constructible_v<T>, "default initialisation would overwrite the adopted pixels");
+        if (m_data.data() == buffer.get())
+            buffer.release(); // adopted, otherwise (empty raster) the unique ptr frees it
+        assert(buffer == nullptr || m_data.empty());
+    }
     Raster(const glm::uvec2& size, const T& fill_value)
-        : m_data(size.x * size.y, fill_value)
+        : m_data(size_t(size.x) * size.y, fill_value)
         , m_width(size.x)
         , m_height(size.y)
     {
     }
 
-    [[nodiscard]] const std::vector<T>& buffer() const { return m_data; }
-    [[nodiscard]] std::vector<T>& buffer() { return m_data; }
+    [[nodiscard]] const Container& buffer() const { return m_data; }
+    [[nodiscard]] Container& buffer() { return m_data; }
     [[nodiscard]] unsigned width() const { return m_width; }
     [[nodiscard]] unsigned height() const { return m_height; }
     [[nodiscard]] glm::uvec2 size() const { return { m_width, m_height }; }
@@ -126,7 +144,31 @@ namespace detail {
     template <typename T> T avg(const T& a, const T& b, const T& c, const T& d) { return (a + b + c + d) / 4; }
 } // namespace detail
 
-template <typename T> std::vector<Raster<T>> generate_mipmap(Raster<T> raster)
+namespace detail {
+    /// 2x2 box filter, dst must have half the size of src.
+    template <typename T> void downsample(const Raster<T>& src, Raster<T>& dst)
+    {
+        for (unsigned j = 0u; j < dst.height(); ++j) {
+            for (unsigned i = 0u; i < dst.width(); ++i) {
+                // clang-format off
+                dst.pixel({ i, j }) = detail::avg(src.pixel({ i * 2, j * 2 }),
+                                                  src.pixel({ i * 2, j * 2 + 1 }),
+                                                  src.pixel({ i * 2 + 1, j * 2 }),
+                                                  src.pixel({ i * 2 + 1, j * 2 + 1 }));
+                // clang-format on
+            }
+        }
+    }
+    // vectorised (SSE2 or NEON) versions, results are identical to the scalar ones (up to float rounding). see Raster.cpp
+    void downsample(const Raster<glm::u8vec4>& src, Raster<glm::u8vec4>& dst);
+    void downsample(const Raster<uint16_t>& src, Raster<uint16_t>& dst);
+    void downsample(const Raster<float>& src, Raster<float>& dst);
+    /// averages rgb in linear space, assuming srgb encoding. alpha is averaged as is.
+    void downsample_srgb(const Raster<glm::u8vec4>& src, Raster<glm::u8vec4>& dst);
+} // namespace detail
+
+/// gamma_correct is only supported for glm::u8vec4 (srgb encoded colours)
+template <typename T> std::vector<Raster<T>> generate_mipmap(Raster<T> raster, bool gamma_correct = false)
 {
     assert(raster.width() == raster.height()); // this code is not tested for differing sizes
     assert(raster.width() > 1); // also not tested
@@ -146,15 +188,14 @@ template <typename T> std::vector<Raster<T>> generate_mipmap(Raster<T> raster)
         Raster<T>& u = mipmap.back();
         mipmap.push_back(Raster<T>(resolution));
         Raster<T>& r = mipmap.back();
-        for (unsigned i = 0u; i < resolution.x; ++i) {
-            for (unsigned j = 0u; j < resolution.y; ++j) {
-                // clang-format off
-                r.pixel({ i, j }) = detail::avg(u.pixel({ i * 2, j * 2 }),
-                                                u.pixel({ i * 2, j * 2 + 1 }),
-                                                u.pixel({ i * 2 + 1, j * 2 }),
-                                                u.pixel({ i * 2 + 1, j * 2 + 1 }));
-                // clang-format on
-            }
+        if constexpr (std::is_same_v<T, glm::u8vec4>) {
+            if (gamma_correct)
+                detail::downsample_srgb(u, r);
+            else
+                detail::downsample(u, r);
+        } else {
+            assert(!gamma_correct);
+            detail::downsample(u, r);
         }
     }
     return mipmap;
@@ -0,0 +1,182 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "RasterAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace nucleus::raster_memory {
+
+namespace {
+    // the requested size is stored in front of the block. the header is as big as the alignment, so the payload stays aligned.
+    constexpr size_t header_size = alignment;
+    constexpr size_t min_pooled_bytes = 4096;
+    constexpr size_t pool_byte_limit = size_t(64) * 1024 * 1024;
+
+    struct Bucket {
+        std::vector<void*> blocks;
+        uint64_t last_used = 0; // pool clock of the last allocation or deallocation of this size
+    };
+
+    struct Pool {
+        std::mutex mutex;
+        std::unordered_map<size_t, Bucket> buckets; // by requested size, empty buckets are erased
+        size_t n_pooled_bytes = 0;
+        uint64_t clock = 0;
+        uint64_t n_hits = 0;
+        uint64_t n_misses = 0;
+    };
+
+    Pool& pool()
+    {
+        // never destroyed, rasters in static storage may be freed after the pool would have been destructed otherwise
+        static auto* pool = new Pool();
+        return *pool;
+    }
+
+    std::byte* block_of(const void* ptr) { return static_cast<std::byte*>(const_cast<void*>(ptr)) - header_size; }
+
+    void* new_block(size_t n_bytes)
+    {
+        auto* block = static_cast<std::byte*>(::operator new(header_size + n_bytes, std::align_val_t(alignment)));
+        std::memcpy(block, &n_bytes, sizeof(n_bytes));
+        return block + header_size;
+    }
+
+    void free_block(void* ptr) { ::operator delete(block_of(ptr), std::align_val_t(alignment)); }
+
+    /// takes blocks of the least recently used sizes out of the pool, until it is within its limit. must be called with the
+    /// pool locked, the returned blocks should be freed after unlocking.
+    std::vector<void*> evict(Pool* p)
+    {
+        std::vector<void*> evicted;
+        while (p->n_pooled_bytes > pool_byte_limit) {
+            const auto lru = std::min_element(p->buckets.begin(), p->buckets.end(), [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+            assert(lru != p->buckets.end());
+            evicted.push_back(lru->second.blocks.back());
+            lru->second.blocks.pop_back();
+            p->n_pooled_bytes -= lru->first;
+            if (lru->second.blocks.empty())
+                p->buckets.erase(lru);
+        }
+        return evicted;
+    }
+
+    void* reallocate(void* ptr, size_t n_bytes, void* (*allocate)(size_t), void (*deallocate)(void*))
+    {
+        if (!ptr)
+            return allocate(n_bytes);
+        const auto old_n_bytes = size(ptr);
+        if (old_n_bytes == n_bytes)
+            return ptr;
+        void* new_ptr = allocate(n_bytes);
+        std::memcpy(new_ptr, ptr, std::min(old_n_bytes, n_bytes));
+        deallocate(ptr);
+        return new_ptr;
+    }
+} // namespace
+
+void* allocate(size_t n_bytes)
+{
+    if (n_bytes >= min_pooled_bytes) {
+        auto& p = pool();
+        std::scoped_lock lock(p.mutex);
+        const auto iter = p.buckets.find(n_bytes);
+        if (iter != p.buckets.end()) {
+            void* ptr = iter->second.blocks.back();
+            iter->second.blocks.pop_back();
+            iter->second.last_used = ++p.clock;
+            if (iter->second.blocks.empty())
+                p.buckets.erase(iter);
+            p.n_pooled_bytes -= n_bytes;
+            ++p.n_hits;
+            return ptr;
+        }
+        ++p.n_misses;
+    }
+    return new_block(n_bytes);
+}
+
+void deallocate(void* ptr)
+{
+    if (!ptr)
+        return;
+    const auto n_bytes = size(ptr);
+    if (n_bytes < min_pooled_bytes || n_bytes > pool_byte_limit) {
+        free_block(ptr);
+        return;
+    }
+    std::vector<void*> evicted;
+    {
+        auto& p = pool();
+        std::scoped_lock lock(p.mutex);
+        auto& bucket = p.buckets[n_bytes];
+        bucket.blocks.push_back(ptr);
+        bucket.last_used = ++p.clock;
+        p.n_pooled_bytes += n_bytes;
+        evicted = evict(&p);
+    }
+    for (void* block : evicted)
+        free_block(block);
+}
+
+void* reallocate(void* ptr, size_t n_bytes) { return reallocate(ptr, n_bytes, &allocate, &deallocate); }
+
+void* allocate_unpooled(size_t n_bytes) { return new_block(n_bytes); }
+
+void deallocate_unpooled(void* ptr)
+{
+    if (ptr)
+        free_block(ptr);
+}
+
+void* reallocate_unpooled(void* ptr, size_t n_bytes) { return reallocate(ptr, n_bytes, &allocate_unpooled, &deallocate_unpooled); }
+
+size_t size(const void* ptr)
+{
+    assert(ptr);
+    size_t n_bytes = 0;
+    std::memcpy(&n_bytes, block_of(ptr), sizeof(n_bytes));
+    return n_bytes;
+}
+
+Statistics statistics()
+{
+    auto& p = pool();
+    std::scoped_lock lock(p.mutex);
+    return { p.n_pooled_bytes, p.n_hits, p.n_misses };
+}
+
+void clear()
+{
+    auto& p = pool();
+    std::scoped_lock lock(p.mutex);
+    for (auto& [n_bytes, bucket] : p.buckets) {
+        for (void* ptr : bucket.blocks)
+            free_block(ptr);
+    }
+    p.buckets.clear();
+    p.n_pooled_bytes = 0;
+}
+
+} // namespace nucleus::raster_memory
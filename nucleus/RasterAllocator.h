@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace nucleus::raster_memory {
+
+constexpr size_t alignment = 64;
+
+/// returns 64 byte aligned memory. blocks of 4 KiB and more are recycled: freed blocks are kept per exact size, so that the tile
+/// sized rasters (65², 256², 512² pixels) of the decode, stitch and compress pipeline are reused instead of being allocated anew
+/// for every tile. above a total limit, the blocks of the least recently used sizes are freed. thread safe.
+[[nodiscard]] void* allocate(size_t n_bytes);
+/// accepts memory from any of the allocation functions. null is ignored.
+void deallocate(void* ptr);
+[[nodiscard]] void* reallocate(void* ptr, size_t n_bytes);
+
+/// same memory layout, but never taken from or put into the pool. meant for decoders (stb_image), whose scratch buffers have
+/// arbitrary sizes. their result can still be adopted by a Raster and is recycled once the raster frees it.
+[[nodiscard]] void* allocate_unpooled(size_t n_bytes);
+void deallocate_unpooled(void* ptr);
+[[nodiscard]] void* reallocate_unpooled(void* ptr, size_t n_bytes);
+/// size that was requested for ptr
+[[nodiscard]] size_t size(const void* ptr);
+
+struct Statistics {
+    size_t n_pooled_bytes = 0;
+    uint64_t n_hits = 0;
+    uint64_t n_misses = 0;
+};
+[[nodiscard]] Statistics statistics();
+/// frees all pooled blocks
+void clear();
+
+struct Deleter {
+    void operator()(void* ptr) const { deallocate(ptr); }
+};
+/// owning pointer to memory from allocate. can be adopted by a Raster.
+template <typename T> using UniqueBuffer = std::unique_ptr<T[], Deleter>;
+
+} // namespace nucleus::raster_memory
+
+namespace nucleus {
+
+/// std allocator on top of raster_memory. elements are default initialised, so that recycled or adopted memory isn't
+/// overwritten (Raster clears explicitly where needed).
+template <typename T> class RasterAllocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    RasterAllocator() noexcept = default;
+    template <typename U> RasterAllocator(const RasterAllocator<U>&) noexcept { }
+    /// the first allocation of exactly n_elements returns adopted (which must come from raster_memory) instead of new memory.
+    /// n_elements must not be 0, containers don't allocate for that and the allocator would keep a pointer that is freed elsewhere.
+    RasterAllocator(T* adopted, size_t n_elements) noexcept
+        : m_adopted(adopted)
+        , m_n_adopted(n_elements)
+    {
+        assert(n_elements > 0 || adopted == nullptr);
+    }
+
+    [[nodiscard]] T* allocate(size_t n)
+    {
+        if (m_adopted) {
+            T* adopted = std::exchange(m_adopted, nullptr);
+            if (n == m_n_adopted)
+                return adopted;
+            raster_memory::deallocate(adopted);
+        }
+        return static_cast<T*>(raster_memory::allocate(n * sizeof(T)));
+    }
+    void deallocate(T* ptr, size_t) noexcept { raster_memory::deallocate(ptr); }
+
+    template <typename U> void construct(U* ptr) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new (static_cast<void*>(ptr)) U; }
+    template <typename U, typename... Args> void construct(U* ptr, Args&&... args) { ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...); }
+
+    [[nodiscard]] RasterAllocator select_on_container_copy_construction() const { return {}; }
+    template <typename U> bool operator==(const RasterAllocator<U>&) const noexcept { return true; }
+
+private:
+    template <typename U> friend class RasterAllocator;
+    T* m_adopted = nullptr;
+    size_t m_n_adopted = 0;
+};
+
+/// pooling only makes sense for pixel types. other types keep the std allocator, so they can be moved in from a plain vector.
+template <typename T> using DefaultRasterAllocator = std::conditional_t<std::is_trivially_copyable_v<T>, RasterAllocator<T>, std::allocator<T>>;
+
+} // namespace nucleus
@@ -0,0 +1,318 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "Declutter.h"
+#include "Factory.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace nucleus::map_label {
+
+namespace {
+    bool overlap(const Declutter::Candidate& a, const Declutter::Candidate& b)
+    {
+        return a.min.x < b.max.x && b.min.x < a.max.x && a.min.y < b.max.y && b.min.y < a.max.y;
+    }
+
+    bool previously_selected(const vector_tile::PoiIndicesPtr& selected, uint32_t index) { return selected && std::binary_search(selected->begin(), selected->end(), index); }
+} // namespace
+
+Declutter::Placement::Placement(std::vector<Candidate> candidates, const glm::vec2& viewport_size, float cell_size)
+    : m_candidates(std::move(candidates))
+    , m_order(m_candidates.size())
+    , m_selected(m_candidates.size(), false)
+    // labels just outside the viewport are placed as well, so that they don't pop in while panning
+    , m_area_min(-cell_size)
+    , m_area_max(viewport_size + cell_size)
+    , m_cell_size(cell_size)
+    , m_grid_size(glm::max(glm::ivec2(glm::ceil((m_area_max - m_area_min) / cell_size)), glm::ivec2(1)))
+    , m_cells(size_t(m_grid_size.x * m_grid_size.y))
+{
+    std::iota(m_order.begin(), m_order.end(), 0u);
+    // previously selected labels win ties, so that the selection is stable while the camera moves
+    std::stable_sort(m_order.begin(), m_order.end(), [&](uint32_t a, uint32_t b) {
+        if (m_candidates[a].importance != m_candidates[b].importance)
+            return m_candidates[a].importance > m_candidates[b].importance;
+        return m_candidates[a].previously_selected && !m_candidates[b].previously_selected;
+    });
+}
+
+bool Declutter::Placement::run(QDeadlineTimer deadline)
+{
+    for (; m_cursor < m_order.size(); ++m_cursor) {
+        if (m_cursor % 64 == 0 && deadline.hasExpired())
+            return false;
+        const auto index = m_order[m_cursor];
+        const auto& candidate = m_candidates[index];
+        const auto on_screen = candidate.max.x > m_area_min.x && candidate.min.x < m_area_max.x && candidate.max.y > m_area_min.y && candidate.min.y < m_area_max.y;
+        if (!on_screen || !is_free(candidate))
+            continue;
+        insert(index);
+        m_selected[index] = true;
+    }
+    return true;
+}
+
+bool Declutter::Placement::done() const { return m_cursor == m_order.size(); }
+
+std::vector<bool> Declutter::Placement::processed() const
+{
+    std::vector<bool> processed(m_candidates.size(), false);
+    for (size_t i = 0; i < m_cursor; ++i)
+        processed[m_order[i]] = true;
+    return processed;
+}
+
+std::vector<bool> Declutter::Placement::selection() const
+{
+    auto selected = m_selected;
+    for (auto i = m_cursor; i < m_order.size(); ++i)
+        selected[m_order[i]] = m_candidates[m_order[i]].previously_selected;
+    return selected;
+}
+
+bool Declutter::Placement::is_free(const Candidate& candidate) const
+{
+    const auto [from, to] = cell_range(candidate);
+    for (int y = from.y; y <= to.y; ++y) {
+        for (int x = from.x; x <= to.x; ++x) {
+            for (const auto placed : m_cells[size_t(y * m_grid_size.x + x)]) {
+                if (overlap(candidate, m_candidates[placed]))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Declutter::Placement::insert(uint32_t index)
+{
+    const auto [from, to] = cell_range(m_candidates[index]);
+    for (int y = from.y; y <= to.y; ++y) {
+        for (int x = from.x; x <= to.x; ++x)
+            m_cells[size_t(y * m_grid_size.x + x)].push_back(index);
+    }
+}
+
+std::pair<glm::ivec2, glm::ivec2> Declutter::Placement::cell_range(const Candidate& candidate) const
+{
+    const auto from = glm::clamp(glm::ivec2(glm::floor((candidate.min - m_area_min) / m_cell_size)), glm::ivec2(0), m_grid_size - 1);
+    const auto to = glm::clamp(glm::ivec2(glm::floor((candidate.max - m_area_min) / m_cell_size)), glm::ivec2(0), m_grid_size - 1);
+    return { from, to };
+}
+
+Declutter::Declutter(QObject* parent)
+    : QObject { parent }
+{
+    m_update_declutter_timer = std::make_unique<QTimer>(this);
+    m_update_declutter_timer->setSingleShot(true);
+
+    connect(m_update_declutter_timer.get(), &QTimer::timeout, this, &Declutter::declutter);
+
+    m_continue_declutter_timer = std::make_unique<QTimer>(this);
+    m_continue_declutter_timer->setSingleShot(true);
+    m_continue_declutter_timer->setInterval(0);
+    connect(m_continue_declutter_timer.get(), &QTimer::timeout, this, &Declutter::declutter);
+}
+
+std::vector<bool> Declutter::select(std::span<const Candidate> candidates, const glm::vec2& viewport_size, float cell_size, QDeadlineTimer deadline)
+{
+    Placement placement(std::vector<Candidate>(candidates.begin(), candidates.end()), viewport_size, cell_size);
+    placement.run(deadline);
+    return placement.selection();
+}
+
+std::optional<Declutter::Candidate> Declutter::project(const vector_tile::PointOfInterest& poi, const glm::dmat4& world_view_projection, const glm::vec2& viewport_size)
+{
+    using LabelType = vector_tile::PointOfInterest::Type;
+    const auto clip = world_view_projection * glm::dvec4(poi.world_space_pos, 1.0);
+    if (clip.w <= 0)
+        return {};
+    const auto ndc = glm::vec2(clip.x / clip.w, clip.y / clip.w);
+    const auto anchor = glm::vec2((ndc.x + 1) * 0.5f * viewport_size.x, (1 - ndc.y) * 0.5f * viewport_size.y);
+
+    // estimate of the label layout in Factory::create_label, in font units: icon centred on the anchor, text above it.
+    // huts and webcams are drawn without text and with a fixed importance.
+    float importance = poi.importance;
+    qsizetype n_chars = poi.name.size();
+    switch (poi.type) {
+    case LabelType::Peak:
+        n_chars += 8; // " (1234m)"
+        break;
+    case LabelType::AlpineHut:
+    case LabelType::Webcam:
+        n_chars = 0;
+        importance = 0.3f;
+        break;
+    default:
+        break;
+    }
+    constexpr auto char_width = Factory::m_font_size * 0.55f;
+    const auto half_width = std::max(Factory::m_icon_size.x, float(n_chars) * char_width) / 2;
+    const auto top = n_chars ? Factory::m_font_size / 2 + 60.0f : Factory::m_icon_size.y / 2;
+    const auto bottom = Factory::m_icon_size.y / 2;
+
+    // font units to pixels, as in labels.vert (without the optional distance scaling)
+    const auto scale = 0.5f * (importance + 2.5f) / 3.5f;
+    return Candidate { anchor - glm::vec2(half_width, top) * scale, anchor + glm::vec2(half_width, bottom) * scale, importance, false };
+}
+
+void Declutter::update_quads(const std::vector<vector_tile::PoiTile>& updated_tiles, const std::vector<tile::Id>& removed_tiles)
+{
+    m_removed_tiles.insert(m_removed_tiles.end(), removed_tiles.begin(), removed_tiles.end());
+    for (const auto& id : removed_tiles)
+        m_tiles.erase(id);
+
+    for (const auto& tile : updated_tiles) {
+        assert(tile.data);
+        // the previous selection is kept, it wins ties against other labels
+        m_tiles[tile.id].tile = tile;
+    }
+
+    // the run refers to the old tiles. new tiles should be shown immediately
+    m_run.reset();
+    m_declutter_should_run = true;
+    declutter();
+}
+
+void Declutter::update_camera(const camera::Definition& camera)
+{
+    m_camera = camera;
+    if (camera.world_view_projection_matrix() == m_decluttered_matrix)
+        return;
+
+    if (!m_update_declutter_timer->isActive()) {
+        // start timer to prevent camera updates from decluttering every frame
+        m_update_declutter_timer->start(m_update_declutter_time);
+        m_declutter_should_run = true;
+        declutter();
+    } else {
+        // declutter again with the latest camera once the timer runs out
+        m_declutter_should_run = true;
+    }
+}
+
+void Declutter::start_run()
+{
+    m_run.emplace();
+    auto& run = *m_run;
+    run.matrix = m_camera ? m_camera->world_view_projection_matrix() : glm::dmat4(0);
+    run.viewport_size = m_camera ? glm::vec2(m_camera->viewport_size()) : glm::vec2(0);
+    m_decluttered_matrix = run.matrix;
+
+    run.ranges.reserve(m_tiles.size());
+    for (auto& key_value : m_tiles) {
+        auto& t = key_value.second;
+        run.ranges.push_back({ &t, run.indices.size() });
+        if (t.tile.visible) {
+            run.indices.insert(run.indices.end(), t.tile.visible->begin(), t.tile.visible->end());
+        } else {
+            const auto begin = run.indices.size();
+            run.indices.resize(begin + t.tile.data->size());
+            std::iota(run.indices.begin() + long(begin), run.indices.end(), 0u);
+        }
+    }
+    run.candidate_of.resize(run.indices.size(), UINT32_MAX);
+}
+
+bool Declutter::continue_run(QDeadlineTimer deadline)
+{
+    assert(m_run && m_camera);
+    auto& run = *m_run;
+    for (; run.n_projected < run.indices.size(); ++run.n_projected) {
+        if (run.n_projected % 64 == 0 && deadline.hasExpired())
+            return false;
+        const auto i = run.n_projected;
+        while (run.current_range + 1 < run.ranges.size() && run.ranges[run.current_range + 1].begin <= i)
+            ++run.current_range;
+        const auto& t = *run.ranges[run.current_range].tile;
+        auto candidate = project(t.tile.data->at(run.indices[i]), run.matrix, run.viewport_size);
+        if (!candidate)
+            continue;
+        candidate->previously_selected = previously_selected(t.selected, run.indices[i]);
+        run.candidate_of[i] = uint32_t(run.candidates.size());
+        run.candidates.push_back(*candidate);
+    }
+    if (!run.placement)
+        run.placement.emplace(std::move(run.candidates), run.viewport_size, m_cell_size);
+    return run.placement->run(deadline);
+}
+
+void Declutter::declutter()
+{
+    if (!m_declutter_should_run)
+        return;
+    m_declutter_should_run = false;
+    const auto deadline = QDeadlineTimer(m_time_budget);
+
+    const auto matrix = m_camera ? m_camera->world_view_projection_matrix() : glm::dmat4(0);
+    const auto viewport_size = m_camera ? glm::vec2(m_camera->viewport_size()) : glm::vec2(0);
+    if (!m_run || m_run->matrix != matrix || m_run->viewport_size != viewport_size)
+        start_run();
+    auto& run = *m_run;
+
+    std::vector<bool> selected(run.indices.size(), true); // without a camera, everything passes
+    if (m_camera) {
+        if (!continue_run(deadline)) {
+            // continue once pending events are processed, unless the camera or the tiles change until then
+            m_declutter_should_run = true;
+            m_continue_declutter_timer->start();
+        }
+        // labels, that weren't placed yet, keep their previous selection. tiles, that weren't emitted yet, have none and show the filter result.
+        const auto mask = run.placement ? run.placement->selection() : std::vector<bool>();
+        const auto processed = run.placement ? run.placement->processed() : std::vector<bool>();
+        for (size_t r = 0; r < run.ranges.size(); ++r) {
+            const auto& t = *run.ranges[r].tile;
+            const auto end = r + 1 < run.ranges.size() ? run.ranges[r + 1].begin : run.indices.size();
+            for (auto i = run.ranges[r].begin; i < end; ++i) {
+                const auto candidate = run.candidate_of[i];
+                if (!run.placement)
+                    selected[i] = !t.selected || previously_selected(t.selected, run.indices[i]); // still projecting
+                else if (candidate == UINT32_MAX)
+                    selected[i] = false; // behind the camera
+                else
+                    selected[i] = (processed[candidate] || t.selected) ? bool(mask[candidate]) : true;
+            }
+        }
+    }
+
+    std::vector<vector_tile::PoiTile> updated_tiles;
+    for (size_t r = 0; r < run.ranges.size(); ++r) {
+        auto& t = *run.ranges[r].tile;
+        const auto end = r + 1 < run.ranges.size() ? run.ranges[r + 1].begin : run.indices.size();
+        vector_tile::PoiIndices subset;
+        for (auto i = run.ranges[r].begin; i < end; ++i) {
+            if (selected[i])
+                subset.push_back(run.indices[i]);
+        }
+        if (t.selected && *t.selected == subset)
+            continue;
+        t.selected = std::make_shared<vector_tile::PoiIndices>(std::move(subset));
+        auto tile = t.tile;
+        tile.visible = t.selected;
+        updated_tiles.push_back(std::move(tile));
+    }
+
+    if (updated_tiles.empty() && m_removed_tiles.empty())
+        return;
+    emit declutter_finished(std::move(updated_tiles), m_removed_tiles);
+    m_removed_tiles.clear(); // sent already
+}
+
+} // namespace nucleus::map_label
@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QObject>
+#include <QTimer>
+#include <glm/glm.hpp>
+#include <nucleus/camera/Definition.h>
+#include <nucleus/tile/types.h>
+#include <nucleus/vector_tile/types.h>
+#include <optional>
+#include <span>
+
+namespace nucleus::map_label {
+
+/// Sits between the Filter and the renderer and reduces the filtered pois to a subset, whose labels don't overlap on screen.
+/// Labels are placed greedily by importance into a screen space grid. The selection is redone (rate limited) when the camera moves,
+/// previously placed labels win ties, so that labels don't flicker. Only tiles whose subset changed are emitted.
+/// Every run has a small time budget. A run, that doesn't finish, continues where it stopped once pending events are processed, unless
+/// the camera or the tiles changed. Meanwhile, labels keep their previous selection, labels of new tiles show the filter result.
+class Declutter : public QObject {
+    Q_OBJECT
+public:
+    struct Candidate {
+        glm::vec2 min = {}; // screen space bounds in pixels
+        glm::vec2 max = {};
+        float importance = 0;
+        bool previously_selected = false;
+    };
+
+    /// resumable greedy placement of non overlapping candidates, more important ones first.
+    class Placement {
+    public:
+        Placement(std::vector<Candidate> candidates, const glm::vec2& viewport_size, float cell_size);
+        /// places candidates until all are processed or the deadline expires. returns true if all are processed.
+        bool run(QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever));
+        [[nodiscard]] bool done() const;
+        /// mask parallel to candidates. candidates, that weren't processed yet, keep their previous selection.
+        [[nodiscard]] std::vector<bool> selection() const;
+        /// mask parallel to candidates, true for candidates that were placed or rejected already.
+        [[nodiscard]] std::vector<bool> processed() const;
+
+    private:
+        [[nodiscard]] bool is_free(const Candidate& candidate) const;
+        void insert(uint32_t index);
+        [[nodiscard]] std::pair<glm::ivec2, glm::ivec2> cell_range(const Candidate& candidate) const;
+
+        std::vector<Candidate> m_candidates;
+        std::vector<uint32_t> m_order;
+        std::vector<bool> m_selected;
+        size_t m_cursor = 0; // into m_order
+        glm::vec2 m_area_min;
+        glm::vec2 m_area_max;
+        float m_cell_size;
+        glm::ivec2 m_grid_size;
+        std::vector<std::vector<uint32_t>> m_cells; // uniform grid, every cell lists the placed labels touching it
+    };
+
+    explicit Declutter(QObject* parent = nullptr);
+
+    /// greedily selects non overlapping candidates, more important ones first. returns a mask parallel to candidates.
+    /// candidates, that couldn't be processed before the deadline, keep their previous selection. see Placement.
+    [[nodiscard]] static std::vector<bool> select(
+        std::span<const Candidate> candidates, const glm::vec2& viewport_size, float cell_size, QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever));
+    /// estimated screen space bounds of the label of poi, if it is in front of the camera.
+    [[nodiscard]] static std::optional<Candidate> project(const vector_tile::PointOfInterest& poi, const glm::dmat4& world_view_projection, const glm::vec2& viewport_size);
+
+public slots:
+    void update_quads(const std::vector<vector_tile::PoiTile>& updated_tiles, const std::vector<tile::Id>& removed_tiles);
+    void update_camera(const nucleus::camera::Definition& camera);
+
+signals:
+    void declutter_finished(const std::vector<vector_tile::PoiTile>& updated_tiles, const std::vector<tile::Id>& removed_tiles);
+
+private slots:
+    void declutter();
+
+private:
+    struct DeclutteredTile {
+        vector_tile::PoiTile tile; // tile.visible holds the filter result
+        vector_tile::PoiIndicesPtr selected; // last emitted subset, null if not emitted yet
+    };
+    struct TileRange {
+        DeclutteredTile* tile;
+        size_t begin; // into Run::indices
+    };
+    /// state of a declutter run, so that it can continue after the time budget ran out.
+    struct Run {
+        glm::dmat4 matrix = glm::dmat4(0);
+        glm::vec2 viewport_size = {};
+        std::vector<TileRange> ranges;
+        std::vector<uint32_t> indices; // into the poi collection of the tile
+        std::vector<uint32_t> candidate_of; // parallel to indices, UINT32_MAX if the poi is behind the camera
+        std::vector<Candidate> candidates; // moved into placement once all are projected
+        size_t n_projected = 0; // indices
+        size_t current_range = 0;
+        std::optional<Placement> placement;
+    };
+    void start_run();
+    /// projects and places as much as the deadline allows. returns true if the run is complete.
+    bool continue_run(QDeadlineTimer deadline);
+
+    std::unordered_map<tile::Id, DeclutteredTile, tile::Id::Hasher> m_tiles;
+    std::vector<tile::Id> m_removed_tiles;
+    std::optional<camera::Definition> m_camera;
+    glm::dmat4 m_decluttered_matrix = glm::dmat4(0);
+    std::optional<Run> m_run; // reset when the tiles (or the filter) change, restarted when the camera changes
+
+    bool m_declutter_should_run = false;
+    constexpr static int m_update_declutter_time = 100; // msec, rate limit for camera updates
+    constexpr static int m_time_budget = 4; // msec per run, the rest is done in the next run
+    constexpr static float m_cell_size = 64.0f; // pixels
+    std::unique_ptr<QTimer> m_update_declutter_timer;
+    std::unique_ptr<QTimer> m_continue_declutter_timer; // zero interval, continues an unfinished run after pending events
+};
+
+} // namespace nucleus::map_label
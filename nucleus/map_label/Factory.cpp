@@ -20,7 +20,11 @@
 #include "Factory.h"
 
 #include <QDebug>
+#include <QDir>
+#include <QFile>
 #include <QSize>
+#include <QStandardPaths>
+#include <numeric>
 
 #include "nucleus/Raster.h"
 #include "nucleus/picker/types.h"
@@ -33,11 +37,32 @@
 
 namespace nucleus::map_label {
 
+Factory::Factory()
+{
+    m_persist_pool = std::make_unique<QThreadPool>();
+    m_persist_pool->setMaxThreadCount(1);
+}
+
+Factory::~Factory() { m_persist_pool->waitForDone(); }
+
 AtlasData Factory::init_font_atlas()
 {
     m_font_renderer.init();
+    // glyphs rendered in previous sessions are read back, only characters missing from the cache are rendered
+    QFile file(font_atlas_cache_path());
+    if (file.open(QIODeviceBase::ReadOnly)) {
+        const auto bytes = file.readAll();
+        const auto r = m_font_renderer.deserialise(std::span<const char>(bytes.constData(), size_t(bytes.size())), m_font_size);
+        if (!r.has_value())
+            qDebug() << QString("Reading the font atlas cache (%1) failed: %2").arg(file.fileName(), r.error());
+    }
+    for (const auto& key_value : m_font_renderer.font_data().char_data)
+        m_rendered_chars.insert(key_value.first);
+    m_font_data = m_font_renderer.font_data();
+
     for (const auto ch : uR"( !"#$%&'()*+,-./0123456789:;<=>@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\]^_`abcdefghijklmnopqrstuvwxyz{|}~§°´ÄÖÜßáâäéìíóöúüýČčěňőřŠšŽž€)") {
-        m_new_chars.emplace(ch);
+        if (!m_rendered_chars.contains(ch))
+            m_new_chars.emplace(ch);
     }
     return renew_font_atlas();
 }
@@ -50,14 +75,45 @@ AtlasData Factory::renew_font_atlas()
         m_rendered_chars.insert(m_new_chars.begin(), m_new_chars.end());
         m_new_chars.clear();
         m_font_data = m_font_renderer.font_data();
-        return { true, m_font_renderer.font_atlas() };
+        persist_font_atlas();
     }
+    // only pages with new glyphs need to be uploaded (all of them after init)
+    return m_font_renderer.take_changed_pages();
+}
 
-    // nothing changed -> return empty
-    AtlasData lm;
+QString Factory::font_atlas_cache_path()
+{
+    const auto base_path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(base_path);
+    return base_path + "/font_atlas";
+}
 
-    lm.changed = false;
-    return lm;
+void Factory::persist_font_atlas()
+{
+    // only the changed pages are copied here. serialising and writing happen on the writer thread, the file is patched in place.
+    // after a failure, the file is removed and the next snapshot contains all pages, so that it can be written from scratch.
+    if (m_font_atlas_persist_failed.exchange(false))
+        m_font_renderer.mark_all_pages_unpersisted();
+    const auto write = [this, snapshot = m_font_renderer.take_snapshot(m_font_size), path = font_atlas_cache_path()]() {
+        QFile file(path);
+        if (!file.open(QIODeviceBase::ReadWrite)) {
+            qDebug() << QString("Couldn't write font atlas cache '%1'!").arg(file.fileName());
+            m_font_atlas_persist_failed = true;
+            return;
+        }
+        const auto r = FontRenderer::patch(&file, snapshot);
+        if (!r.has_value()) {
+            // a partially written file must not be read back
+            qDebug() << QString("Couldn't write font atlas cache '%1': %2").arg(path, r.error());
+            file.remove();
+            m_font_atlas_persist_failed = true;
+        }
+    };
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    write();
+#else
+    m_persist_pool->start(write);
+#endif
 }
 
 /**
@@ -93,10 +149,17 @@ Raster<glm::u8vec4> Factory::label_icons()
 }
 
 std::tuple<std::vector<VertexData>, glm::dvec3, AtlasData> Factory::create_labels(const vector_tile::PointOfInterestCollection& pois)
+{
+    std::vector<uint32_t> indices(pois.size());
+    std::iota(indices.begin(), indices.end(), 0u);
+    return create_labels(pois, indices);
+}
+
+std::tuple<std::vector<VertexData>, glm::dvec3, AtlasData> Factory::create_labels(const vector_tile::PointOfInterestCollection& pois, std::span<const uint32_t> indices)
 {
 
-    for (const auto& f : pois) {
-        for (const auto ch : f.name) {
+    for (const auto i : indices) {
+        for (const auto ch : pois[i].name) {
             if (m_rendered_chars.contains(ch.unicode()))
                 continue;
             m_new_chars.insert(ch.unicode());
@@ -105,19 +168,20 @@ std::tuple<std::vector<VertexData>, glm::dvec3, AtlasData> Factory::create_label
 
     AtlasData atlas_data = Factory::renew_font_atlas();
 
-    glm::dvec3 reference_point = pois.empty() ? glm::dvec3 {} : pois.front().world_space_pos;
+    glm::dvec3 reference_point = indices.empty() ? glm::dvec3 {} : pois[indices.front()].world_space_pos;
 
     std::vector<VertexData> label_data;
-    label_data.reserve(pois.size());
-    for (const auto& p : pois) {
+    label_data.reserve(indices.size());
+    for (const auto i : indices) {
+        const auto& p = pois[i];
         QString display_name = p.name;
         float importance = p.importance;
         switch (p.type) {
         case LabelType::Peak: {
             auto ele = p.attributes.value("ele");
-            if (!ele.isValid())
+            if (ele.isEmpty())
                 ele = QString::number(p.lat_long_alt.z, 'f', 0);
-            display_name = QString("%1 (%2m)").arg(p.name, ele.toString());
+            display_name = QString("%1 (%2m)").arg(p.name, ele);
             break;
         }
         case LabelType::AlpineHut:
@@ -19,10 +19,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
 #include <QSize>
+#include <QThreadPool>
 #include <stb_slim/stb_truetype.h>
 
 #include <nucleus/Raster.h>
@@ -36,27 +40,38 @@ class Factory {
     using LabelType = vector_tile::PointOfInterest::Type;
 
 public:
+    Factory();
+    ~Factory();
+    Factory(const Factory&) = delete;
+    Factory& operator=(const Factory&) = delete;
+
+    /// reads the glyphs rendered in previous sessions from the disk cache and renders the basic character set. returns all pages.
     AtlasData init_font_atlas();
+    /// renders new characters and returns the changed pages. the atlas is persisted in the background.
     AtlasData renew_font_atlas();
     Raster<glm::u8vec4> label_icons();
     std::tuple<std::vector<VertexData>, glm::dvec3, AtlasData> create_labels(const vector_tile::PointOfInterestCollection& pois);
+    /// creates labels only for the pois at the given indices
+    std::tuple<std::vector<VertexData>, glm::dvec3, AtlasData> create_labels(const vector_tile::PointOfInterestCollection& pois, std::span<const uint32_t> indices);
 
     static const inline std::vector<unsigned int> m_indices = { 0, 1, 2, 0, 2, 3 };
+    constexpr static float m_font_size = 48.0f;
+    constexpr static glm::vec2 m_icon_size = glm::vec2(48.0f);
 
 private:
     void create_label(const QString& text, const glm::vec3& position, LabelType type, uint32_t id, float importance, std::vector<VertexData>& vertex_data);
 
-private:
-    constexpr static float m_font_size = 48.0f;
-    constexpr static glm::vec2 m_icon_size = glm::vec2(48.0f);
-
     std::unordered_map<LabelType, glm::vec4> m_icon_uvs;
 
     std::vector<float> inline create_text_meta(std::u16string* safe_chars, float* text_width);
+    void persist_font_atlas();
+    static QString font_atlas_cache_path();
 
     FontData m_font_data;
     std::set<char16_t> m_rendered_chars;
     std::set<char16_t> m_new_chars;
     FontRenderer m_font_renderer;
+    std::unique_ptr<QThreadPool> m_persist_pool; // single writer thread for the font atlas cache
+    std::atomic<bool> m_font_atlas_persist_failed = false; // set by the writer, the next snapshot must contain all pages
 };
 } // namespace nucleus::maplabel
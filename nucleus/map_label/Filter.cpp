@@ -19,6 +19,8 @@
 
 #include "Filter.h"
 #include <QVariant>
+#include <array>
+#include <limits>
 
 namespace nucleus::map_label {
 
@@ -33,10 +35,14 @@ Filter::Filter(QObject* parent)
 
 void Filter::update_filter(const FilterDefinitions& filter_definitions)
 {
+    // only tiles containing pois of a type with changed definitions need to be filtered again
+    const auto types = affected_types(m_definitions, filter_definitions);
     m_definitions = filter_definitions;
 
-    for (const auto& key_value : m_all_pois)
-        m_tiles_to_filter.push(key_value.first);
+    for (const auto& key_value : m_all_pois) {
+        if (key_value.second.types & types)
+            m_tiles_to_filter.push(key_value.first);
+    }
 
     if (!m_update_filter_timer->isActive()) {
         // start timer to prevent future filter updates to happen rapidly one after another
@@ -62,12 +68,16 @@ void Filter::update_quads(const std::vector<vector_tile::PoiTile>& updated_tiles
 
     for (const auto& tile : updated_tiles) {
         assert(tile.data);
+        assert(tile.columns);
         assert(tile.id.zoom_level < 100);
         assert(!m_all_pois.contains(tile.id));
         assert(std::find(removed_tiles.cbegin(), removed_tiles.cend(), tile.id) == removed_tiles.cend());
 
+        uint32_t types = 0;
+        for (const auto type : tile.columns->types)
+            types |= 1u << unsigned(type);
         m_tiles_to_filter.push(tile.id);
-        m_all_pois[tile.id] = tile.data;
+        m_all_pois[tile.id] = { tile, types };
     }
 
 
@@ -76,45 +86,56 @@ void Filter::update_quads(const std::vector<vector_tile::PoiTile>& updated_tiles
     filter();
 }
 
-PointOfInterestCollection Filter::apply_filter(const PointOfInterestCollection& unfiltered_pois)
+PoiIndices Filter::apply_filter(const PoiColumns& columns) const
+{
+    // the definitions are turned into per type tables, so that the loop is the same simple test for all pois
+    constexpr auto n_types = size_t(LabelType::NumberOfElements);
+    std::array<bool, n_types> visible = {};
+    std::array<float, n_types> min_elevation = {};
+    std::array<float, n_types> max_elevation = {};
+    std::array<uint8_t, n_types> required_features = {};
+    min_elevation.fill(-std::numeric_limits<float>::infinity());
+    max_elevation.fill(std::numeric_limits<float>::infinity());
+
+    visible[size_t(LabelType::Unknown)] = true;
+    visible[size_t(LabelType::Peak)] = m_definitions.m_peaks_visible;
+    min_elevation[size_t(LabelType::Peak)] = m_definitions.m_peak_ele_range.x();
+    max_elevation[size_t(LabelType::Peak)] = m_definitions.m_peak_ele_range.y();
+    required_features[size_t(LabelType::Peak)] = (m_definitions.m_peak_has_cross ? PoiColumns::SummitCross : 0) | (m_definitions.m_peak_has_register ? PoiColumns::SummitRegister : 0);
+    visible[size_t(LabelType::Settlement)] = m_definitions.m_cities_visible;
+    visible[size_t(LabelType::AlpineHut)] = m_definitions.m_cottages_visible;
+    required_features[size_t(LabelType::AlpineHut)] = (m_definitions.m_cottage_has_shower ? PoiColumns::Shower : 0) | (m_definitions.m_cottage_has_contact ? PoiColumns::Contact : 0);
+    visible[size_t(LabelType::Webcam)] = m_definitions.m_webcams_visible;
+
+    assert(columns.types.size() == columns.elevations.size() && columns.types.size() == columns.features.size());
+    PoiIndices indices;
+    indices.reserve(columns.types.size());
+    for (size_t i = 0; i < columns.types.size(); ++i) {
+        const auto t = size_t(columns.types[i]);
+        assert(t < n_types);
+        const auto elevation = columns.elevations[i];
+        const auto keep = visible[t] && elevation >= min_elevation[t] && elevation <= max_elevation[t] && (columns.features[i] & required_features[t]) == required_features[t];
+        if (keep)
+            indices.push_back(uint32_t(i));
+    }
+    return indices;
+}
+
+uint32_t Filter::affected_types(const FilterDefinitions& a, const FilterDefinitions& b)
 {
-    PointOfInterestCollection filtered_pois;
-    filtered_pois.reserve(unfiltered_pois.size());
-    std::copy_if(unfiltered_pois.begin(), unfiltered_pois.end(), std::back_inserter(filtered_pois), [this](const PointOfInterest& poi) {
-        if (poi.type == LabelType::Peak) {
-            if (!m_definitions.m_peaks_visible)
-                return false;
-            if (poi.lat_long_alt.z < m_definitions.m_peak_ele_range.x() || poi.lat_long_alt.z > m_definitions.m_peak_ele_range.y())
-                return false;
-            if (m_definitions.m_peak_has_cross && !(poi.attributes.value("summit_cross") == "yes"))
-                return false;
-            if (m_definitions.m_peak_has_register && !(poi.attributes.value("summit_register") == "yes"))
-                return false;
-            return true;
-        }
-        if (poi.type == LabelType::Settlement) {
-            if (!m_definitions.m_cities_visible)
-                return false;
-            return true;
-        }
-        if (poi.type == LabelType::AlpineHut) {
-            if (!m_definitions.m_cottages_visible)
-                return false;
-            if (m_definitions.m_cottage_has_shower && !(poi.attributes.value("shower") == "yes"))
-                return false;
-            if (m_definitions.m_cottage_has_contact && !(poi.attributes.value("email").isValid() || poi.attributes.value("phone").isValid()))
-                return false;
-            return true;
-        }
-        if (poi.type == LabelType::Webcam) {
-            if (!m_definitions.m_webcams_visible)
-                return false;
-            return true;
-        }
-        assert(false);
-        return true;
-    });
-    return filtered_pois;
+    const auto bit = [](LabelType type) { return 1u << unsigned(type); };
+    uint32_t types = 0;
+    if (a.m_peaks_visible != b.m_peaks_visible || a.m_peak_ele_range != b.m_peak_ele_range || a.m_peak_has_cross != b.m_peak_has_cross
+        || a.m_peak_has_register != b.m_peak_has_register)
+        types |= bit(LabelType::Peak);
+    if (a.m_cities_visible != b.m_cities_visible || a.m_city_population_range != b.m_city_population_range)
+        types |= bit(LabelType::Settlement);
+    if (a.m_cottages_visible != b.m_cottages_visible || a.m_cottage_has_shower != b.m_cottage_has_shower || a.m_cottage_has_contact != b.m_cottage_has_contact
+        || a.m_cottage_ele_range != b.m_cottage_ele_range)
+        types |= bit(LabelType::AlpineHut);
+    if (a.m_webcams_visible != b.m_webcams_visible)
+        types |= bit(LabelType::Webcam);
+    return types;
 }
 
 void Filter::filter()
@@ -132,10 +153,19 @@ void Filter::filter()
         if (!m_all_pois.contains(tile_id))
             continue; // tile was removed in the meantime
 
-        filtered_tiles.push_back({ tile_id, std::make_shared<PointOfInterestCollection>(apply_filter(*m_all_pois.at(tile_id))) });
+        // the pois are shared, only the indices of the visible ones are new. tiles are only emitted if their visible set changed.
+        auto& tile = m_all_pois.at(tile_id).tile;
+        auto visible = apply_filter(*tile.columns);
+        if (tile.visible && *tile.visible == visible)
+            continue;
+        tile.visible = std::make_shared<PoiIndices>(std::move(visible));
+        filtered_tiles.push_back(tile);
     }
 
+    if (filtered_tiles.empty() && m_removed_tiles.empty())
+        return;
     emit filter_finished(std::move(filtered_tiles), m_removed_tiles);
+    m_removed_tiles.clear(); // sent already
 }
 
 } // namespace nucleus::maplabel
@@ -38,6 +38,11 @@ class Filter : public QObject {
 public:
     explicit Filter(QObject* parent = nullptr);
 
+    /// returns the indices of the pois passing the current filter definitions.
+    [[nodiscard]] PoiIndices apply_filter(const PoiColumns& columns) const;
+    /// bitmask of the poi types, whose filter result can differ between the two definitions.
+    [[nodiscard]] static uint32_t affected_types(const FilterDefinitions& a, const FilterDefinitions& b);
+
 public slots:
     void update_filter(const FilterDefinitions& filter_definitions);
     void update_quads(const std::vector<vector_tile::PoiTile>& updated_tiles, const std::vector<tile::Id>& removed_tiles);
@@ -49,15 +54,16 @@ private slots:
     void filter();
 
 private:
-    std::unordered_map<tile::Id, PointOfInterestCollectionPtr, tile::Id::Hasher> m_all_pois;
+    struct FilteredTile {
+        vector_tile::PoiTile tile; // tile.visible holds the last emitted result
+        uint32_t types = 0; // bitmask of the poi types in this tile
+    };
+    std::unordered_map<tile::Id, FilteredTile, tile::Id::Hasher> m_all_pois;
     std::queue<tile::Id> m_tiles_to_filter;
     std::vector<tile::Id> m_removed_tiles;
 
     FilterDefinitions m_definitions;
-
-    PointOfInterestCollection apply_filter(const PointOfInterestCollection& unfiltered_pois);
-
-    bool m_filter_should_run;
+    bool m_filter_should_run = false;
     constexpr static int m_update_filter_time = 400;
     std::unique_ptr<QTimer> m_update_filter_timer;
 };
@@ -19,10 +19,13 @@
 
 #include "FontRenderer.h"
 
-#include <QFile>
+#include <QCryptographicHash>
 #include <QDebug>
-#include <vector>
+#include <QFile>
 #include <QString>
+#include <cstring>
+#include <vector>
+#include <zpp_bits.h>
 
 namespace nucleus::map_label {
 
@@ -51,6 +54,8 @@ void FontRenderer::init()
     m_texture_index = 0;
 
     m_font_atlas.push_back(Raster<glm::u8vec2>({ m_font_atlas_size.width(), m_font_atlas_size.height() }, glm::u8vec2(0)));
+    m_changed_pages = { 0 };
+    m_unpersisted_pages = { 0 };
 }
 
 void FontRenderer::render(std::set<char16_t> chars, float font_size)
@@ -74,15 +79,13 @@ void FontRenderer::render(std::set<char16_t> chars, float font_size)
 
 }
 
-void FontRenderer::render_text(std::set<char16_t> chars, float font_size)
+void FontRenderer::render_text(const std::set<char16_t>& chars, float font_size)
 {
     float scale = stbtt_ScaleForPixelHeight(&m_font_data.fontinfo, font_size);
 
-    // stb_truetype only supports one dimensional bitmap
-    // we therefore have to create a 1d temp_raster that is later merged with the actual texture
-    std::vector<Raster<uint8_t>> temp_raster = std::vector<Raster<uint8_t>>();
-    int temp_texture_index = 0;
-    temp_raster.push_back(Raster<uint8_t>({ m_font_atlas_size.width(), m_font_atlas_size.height() }, uint8_t(0)));
+    // stb_truetype only supports one channel bitmaps. glyphs are rendered into a small temp raster and copied into the first channel
+    // of the atlas, so that only the touched pages change.
+    Raster<uint8_t> glyph_raster;
 
     for (const char16_t& c : chars) {
         // code adapted from stbtt_BakeFontBitmap()
@@ -100,8 +103,7 @@ void FontRenderer::render_text(std::set<char16_t> chars, float font_size)
             >= m_font_atlas_size.height()) // check if it fits vertically AFTER potentially moving to next row
         {
             // char doesnt fit on the current texture -> create a new texture and switch to this
-            m_texture_index++;
-            if (m_texture_index >= m_max_textures) {
+            if (m_texture_index + 1 >= m_max_textures) {
                 // !! there are too many chars !!
                 // Ways to solve this (roughly from easy to difficult):
                 // - increase the texture size
@@ -116,17 +118,24 @@ void FontRenderer::render_text(std::set<char16_t> chars, float font_size)
                 assert(false);
                 break; // doesnt fit in image´
             }
-
-            temp_texture_index++;
-            temp_raster.push_back(Raster<uint8_t>({ m_font_atlas_size.width(), m_font_atlas_size.height() }, uint8_t(0)));
+            m_texture_index++;
             m_font_atlas.push_back(Raster<glm::u8vec2>({ m_font_atlas_size.width(), m_font_atlas_size.height() }, glm::u8vec2(0)));
 
             m_y = m_outline_margin + m_font_padding.y;
             m_bottom_y = m_outline_margin + m_font_padding.y;
         }
 
+        glyph_raster = Raster<uint8_t>({ unsigned(glyph_width), unsigned(glyph_height) }, uint8_t(0));
+        stbtt_MakeGlyphBitmap(&m_font_data.fontinfo, glyph_raster.data(), glyph_width, glyph_height, glyph_width, scale, scale, glyph_index);
+        auto& page = m_font_atlas[size_t(m_texture_index)];
+        for (unsigned y = 0; y < glyph_raster.height(); ++y) {
+            for (unsigned x = 0; x < glyph_raster.width(); ++x)
+                page.pixel({ unsigned(m_x) + x, unsigned(m_y) + y }).x = glyph_raster.pixel({ x, y });
+        }
+        m_changed_pages.insert(unsigned(m_texture_index));
+        m_unpersisted_pages.insert(unsigned(m_texture_index));
+
         // clang-format off
-        stbtt_MakeGlyphBitmap(&m_font_data.fontinfo, temp_raster[temp_texture_index].data() + m_x + m_y * m_font_atlas_size.width(), glyph_width, glyph_height, m_font_atlas_size.width(), scale, scale, glyph_index);
         m_font_data.char_data.emplace(c, CharData {
                                              uint16_t(m_x - m_outline_margin),
                                              uint16_t(m_y - m_outline_margin),
@@ -141,18 +150,9 @@ void FontRenderer::render_text(std::set<char16_t> chars, float font_size)
         if (m_y + glyph_height + m_outline_margin + m_font_padding.y > m_bottom_y)
             m_bottom_y = m_y + glyph_height + 2 * m_outline_margin + m_font_padding.y;
     }
-
-    // merge temp_raster with font_atlas
-    for(size_t i = 0; i < temp_raster.size(); i++)
-    {
-        // main index -> index of m_font_atlas
-        const auto main_index = m_font_atlas.size()-temp_raster.size()+i;
-        std::transform(m_font_atlas[main_index].cbegin(), m_font_atlas[main_index].cend(), temp_raster[i].cbegin(), m_font_atlas[main_index].begin(), [](const auto& v1,const auto& v2) { return glm::u8vec2(std::max(v1.x, v2), v1.y); });
-    }
-
 }
 
-void FontRenderer::make_outline(std::set<char16_t> chars)
+void FontRenderer::make_outline(const std::set<char16_t>& chars)
 {
     unsigned outline_margin = unsigned(std::ceil(m_font_outline));
 
@@ -164,6 +164,8 @@ void FontRenderer::make_outline(std::set<char16_t> chars)
 
     for(auto& c : chars)
     {
+        if (!m_font_data.char_data.contains(c))
+            continue; // didn't fit into the atlas
         auto char_data = m_font_data.char_data.at(c);
 
         // only visit the area the current char is located at
@@ -190,5 +192,157 @@ void FontRenderer::make_outline(std::set<char16_t> chars)
 
 std::vector<Raster<glm::u8vec2>> FontRenderer::font_atlas() { return m_font_atlas; }
 
+AtlasData FontRenderer::take_changed_pages()
+{
+    AtlasData atlas_data { !m_changed_pages.empty(), {}, {} };
+    for (const auto index : m_changed_pages) {
+        atlas_data.font_atlas.push_back(m_font_atlas[index]);
+        atlas_data.page_indices.push_back(index);
+    }
+    m_changed_pages.clear();
+    return atlas_data;
+}
+
+namespace {
+    std::array<char, 20> font_hash(const QByteArray& font_file)
+    {
+        const auto hash = QCryptographicHash::hash(font_file, QCryptographicHash::Sha1);
+        std::array<char, 20> a = {};
+        std::copy_n(hash.constData(), std::min(qsizetype(a.size()), hash.size()), a.begin());
+        return a;
+    }
+
+    constexpr auto page_size = size_t(FontRenderer::m_font_atlas_size.width() * FontRenderer::m_font_atlas_size.height()) * sizeof(glm::u8vec2);
+} // namespace
+
+FontRenderer::Header FontRenderer::header(float font_size) const
+{
+    Header header { version_information, font_hash(m_font_file), font_size, m_font_outline, m_font_atlas_size.width(), m_font_atlas_size.height(), m_x, m_y,
+        m_bottom_y, m_texture_index, {} };
+    header.char_data.reserve(m_font_data.char_data.size());
+    for (const auto& [c, data] : m_font_data.char_data)
+        header.char_data.emplace_back(uint16_t(c), data);
+    return header;
+}
+
+std::vector<char> FontRenderer::serialise_header(const Header& header)
+{
+    // the serialised header is followed by its size, so that it can be found from the end
+    std::vector<char> bytes;
+    zpp::bits::out out(bytes);
+    if (failure(out(header)))
+        return {};
+    const auto header_size = uint64_t(out.position());
+    bytes.resize(header_size + sizeof(header_size));
+    std::memcpy(bytes.data() + header_size, &header_size, sizeof(header_size));
+    return bytes;
+}
+
+std::vector<char> FontRenderer::serialise(float font_size) const
+{
+    const auto header_bytes = serialise_header(header(font_size));
+    if (header_bytes.empty())
+        return {};
+    std::vector<char> bytes;
+    bytes.reserve(m_font_atlas.size() * page_size + header_bytes.size());
+    for (const auto& page : m_font_atlas)
+        bytes.insert(bytes.end(), reinterpret_cast<const char*>(page.bytes()), reinterpret_cast<const char*>(page.bytes()) + page.size_in_bytes());
+    bytes.insert(bytes.end(), header_bytes.begin(), header_bytes.end());
+    return bytes;
+}
+
+tl::expected<void, QString> FontRenderer::deserialise(std::span<const char> bytes, float font_size)
+{
+    uint64_t header_size = 0;
+    if (bytes.size() < sizeof(header_size))
+        return tl::unexpected(QString("Font atlas has unexpected size!"));
+    std::memcpy(&header_size, bytes.data() + bytes.size() - sizeof(header_size), sizeof(header_size));
+    if (header_size > bytes.size() - sizeof(header_size))
+        return tl::unexpected(QString("Font atlas has unexpected size!"));
+    const auto pages_size = bytes.size() - sizeof(header_size) - size_t(header_size);
+
+    Header header;
+    zpp::bits::in in(bytes.subspan(pages_size, size_t(header_size)));
+    if (failure(in(header)))
+        return tl::unexpected(QString("Couldn't read font atlas header!"));
+    if (header.version != version_information)
+        return tl::unexpected(QString("Font atlas has incompatible version!"));
+    if (header.font_hash != font_hash(m_font_file) || header.font_size != font_size || header.font_outline != m_font_outline
+        || header.atlas_width != m_font_atlas_size.width() || header.atlas_height != m_font_atlas_size.height())
+        return tl::unexpected(QString("Font atlas was rendered with a different font or different parameters!"));
+    if (header.texture_index < 0 || header.texture_index >= m_max_textures)
+        return tl::unexpected(QString("Font atlas is corrupt!"));
+
+    const auto n_pages = size_t(header.texture_index + 1);
+    if (pages_size != n_pages * page_size)
+        return tl::unexpected(QString("Font atlas has unexpected size!"));
+
+    std::vector<Raster<glm::u8vec2>> atlas;
+    atlas.reserve(n_pages);
+    for (size_t i = 0; i < n_pages; ++i) {
+        atlas.emplace_back(glm::uvec2(m_font_atlas_size.width(), m_font_atlas_size.height()));
+        std::memcpy(atlas.back().bytes(), bytes.data() + i * page_size, page_size);
+    }
+
+    m_font_atlas = std::move(atlas);
+    m_font_data.char_data.clear();
+    for (const auto& [c, data] : header.char_data)
+        m_font_data.char_data[char16_t(c)] = data;
+    m_x = header.x;
+    m_y = header.y;
+    m_bottom_y = header.bottom_y;
+    m_texture_index = header.texture_index;
+    m_changed_pages.clear();
+    for (unsigned i = 0; i < n_pages; ++i)
+        m_changed_pages.insert(i);
+    m_unpersisted_pages.clear();
+    return {};
+}
+
+FontRenderer::Snapshot FontRenderer::take_snapshot(float font_size)
+{
+    Snapshot snapshot { header(font_size), {}, {} };
+    for (const auto index : m_unpersisted_pages) {
+        snapshot.pages.push_back(m_font_atlas[index]);
+        snapshot.page_indices.push_back(index);
+    }
+    m_unpersisted_pages.clear();
+    return snapshot;
+}
+
+void FontRenderer::mark_all_pages_unpersisted()
+{
+    for (unsigned i = 0; i < m_font_atlas.size(); ++i)
+        m_unpersisted_pages.insert(i);
+}
+
+tl::expected<void, QString> FontRenderer::patch(QFileDevice* file, const Snapshot& snapshot)
+{
+    assert(snapshot.pages.size() == snapshot.page_indices.size());
+    const auto n_pages = size_t(snapshot.header.texture_index + 1);
+    if (file->size() == 0 && snapshot.pages.size() != n_pages)
+        return tl::unexpected(QString("Font atlas snapshot is incomplete, and there is nothing to patch!"));
+
+    // pages are written first. new glyphs go into space, that is unused according to the old header, so an interrupted
+    // write of pages, that existed before, leaves the old state readable. a new page is written over the old header and its
+    // size though. if that is interrupted, page bytes end up where deserialise() expects the header (or its size), which
+    // fails the version and size checks in practice, and the atlas is rendered anew.
+    for (size_t i = 0; i < snapshot.pages.size(); ++i) {
+        const auto& page = snapshot.pages[i];
+        assert(page.size_in_bytes() == page_size);
+        if (!file->seek(qint64(snapshot.page_indices[i] * page_size))
+            || file->write(reinterpret_cast<const char*>(page.bytes()), qint64(page.size_in_bytes())) != qint64(page.size_in_bytes()))
+            return tl::unexpected(file->errorString());
+    }
+    const auto header_bytes = serialise_header(snapshot.header);
+    if (header_bytes.empty())
+        return tl::unexpected(QString("Couldn't serialise font atlas header!"));
+    const auto end = qint64(n_pages * page_size + header_bytes.size());
+    if (!file->seek(qint64(n_pages * page_size)) || file->write(header_bytes.data(), qint64(header_bytes.size())) != qint64(header_bytes.size()) || !file->resize(end)
+        || !file->flush())
+        return tl::unexpected(file->errorString());
+    return {};
+}
+
 const FontData& FontRenderer::font_data() { return m_font_data; }
 } // namespace nucleus::map_label
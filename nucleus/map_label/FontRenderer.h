@@ -20,8 +20,14 @@
 
 #include <stb_slim/stb_truetype.h>
 
+#include <QByteArray>
+#include <QFileDevice>
 #include <QSize>
+#include <QString>
+#include <array>
 #include <set>
+#include <span>
+#include <tl/expected.hpp>
 #include <unordered_map>
 #include <vector>
 
@@ -45,13 +51,52 @@ public:
     void render(std::set<char16_t> chars, float font_size);
     const FontData& font_data();
     std::vector<Raster<glm::u8vec2>> font_atlas();
+    /// pages, that were modified since the last call (or since init). the returned atlas contains only those.
+    AtlasData take_changed_pages();
+
+    /// packing state and glyph metrics, i.e., everything but the pages.
+    struct Header {
+        std::array<char, 25> version = {};
+        std::array<char, 20> font_hash = {};
+        float font_size = 0;
+        float font_outline = 0;
+        int32_t atlas_width = 0;
+        int32_t atlas_height = 0;
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t bottom_y = 0;
+        int32_t texture_index = 0;
+        std::vector<std::pair<uint16_t, CharData>> char_data;
+    };
+    /// the header and the pages, that changed since the last snapshot. taken on the rendering thread and written on another one with patch().
+    struct Snapshot {
+        Header header;
+        std::vector<Raster<glm::u8vec2>> pages;
+        std::vector<unsigned> page_indices;
+    };
+
+    /// atlas and packing state, so that rendering can continue after deserialising. init() must be called before deserialise().
+    /// the pages are stored at fixed offsets, followed by the serialised header and its size, so that a file can be patched.
+    [[nodiscard]] std::vector<char> serialise(float font_size) const;
+    /// fails if the data was written by a different version, for a different font, or with different parameters. the state is unchanged on failure.
+    [[nodiscard]] tl::expected<void, QString> deserialise(std::span<const char> bytes, float font_size);
+    /// pages read by deserialise() are persisted already, all others are contained in the first snapshot.
+    [[nodiscard]] Snapshot take_snapshot(float font_size);
+    /// the next snapshot contains all pages, e.g., because writing a previous one failed.
+    void mark_all_pages_unpersisted();
+    /// writes the pages of the snapshot and the header into a file holding the state of the previous snapshot (or deserialise()).
+    /// an empty file is only written if the snapshot contains all pages.
+    [[nodiscard]] static tl::expected<void, QString> patch(QFileDevice* file, const Snapshot& snapshot);
 
     static constexpr QSize m_font_atlas_size = QSize(1024, 1024);
     static constexpr int m_max_textures = 8;
+    static constexpr std::array<char, 25> version_information = { "FontAtlas, version 0.2" };
 
 private:
-    void render_text(std::set<char16_t> chars, float font_size);
-    void make_outline(std::set<char16_t> chars);
+    [[nodiscard]] Header header(float font_size) const;
+    [[nodiscard]] static std::vector<char> serialise_header(const Header& header);
+    void render_text(const std::set<char16_t>& chars, float font_size);
+    void make_outline(const std::set<char16_t>& chars);
 
 
     static constexpr float m_font_outline = 7.2f;
@@ -67,6 +112,8 @@ private:
     FontData m_font_data;
 
     std::vector<Raster<glm::u8vec2>> m_font_atlas;
+    std::set<unsigned> m_changed_pages; // not uploaded yet
+    std::set<unsigned> m_unpersisted_pages; // not in a snapshot yet
 
     QByteArray m_font_file;
 
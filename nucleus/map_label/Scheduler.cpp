@@ -18,6 +18,7 @@
  *****************************************************************************/
 
 #include "Scheduler.h"
+#include <nucleus/utils/thread.h>
 #include <nucleus/vector_tile/parse.h>
 
 namespace nucleus::map_label {
@@ -31,18 +32,18 @@ Scheduler::~Scheduler() = default;
 
 void Scheduler::transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads)
 {
-    std::vector<vector_tile::PoiTile> new_gpu_tiles;
-    new_gpu_tiles.reserve(new_quads.size() * 4);
-    for (const auto& data_quad : new_quads) {
+    std::vector<vector_tile::PoiTile> new_gpu_tiles(new_quads.size() * 4);
+    const auto data_querier = dataquerier();
+    // tiles are parsed in parallel, DataQuerier is thread safe.
+    nucleus::utils::thread::parallel_for(new_gpu_tiles.size(), [&](size_t i) {
+        const auto& data_quad = new_quads[i / 4];
         assert(data_quad.n_tiles == 4);
-        for (const auto& data_tile : data_quad.tiles) {
-            vector_tile::PoiTile gpu_tile;
-            gpu_tile.id = data_tile.id;
-            auto pois = nucleus::vector_tile::parse::points_of_interest(*data_tile.data, dataquerier().get());
-            gpu_tile.data = std::make_shared<vector_tile::PointOfInterestCollection>(std::move(pois));
-            new_gpu_tiles.emplace_back(gpu_tile);
-        }
-    };
+        const auto& data_tile = data_quad.tiles[i % 4];
+        new_gpu_tiles[i].id = data_tile.id;
+        auto pois = nucleus::vector_tile::parse::points_of_interest(*data_tile.data, data_querier.get());
+        new_gpu_tiles[i].columns = std::make_shared<vector_tile::PoiColumns>(nucleus::vector_tile::parse::columns(pois));
+        new_gpu_tiles[i].data = std::make_shared<vector_tile::PointOfInterestCollection>(std::move(pois));
+    });
 
     std::vector<tile::Id> deleted_tiles;
     deleted_tiles.reserve(deleted_quads.size() * 4);
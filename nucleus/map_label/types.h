@@ -45,7 +45,8 @@ struct VertexData {
 
 struct AtlasData {
     bool changed;
-    std::vector<Raster<glm::u8vec2>> font_atlas;
+    std::vector<Raster<glm::u8vec2>> font_atlas; // only the changed pages
+    std::vector<unsigned> page_indices; // texture array index of every page in font_atlas
 };
 
 } // namespace nucleus::maplabel
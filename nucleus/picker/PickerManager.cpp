@@ -69,8 +69,8 @@ void PickerManager::eval_pick(uint32_t value)
         Feature picked;
         picked.title = poi->name;
         // picked.properties = poi->attributes;
-        for (const auto& key_value : poi->attributes.asKeyValueRange()) {
-            picked.properties[key_value.first] = key_value.second;
+        for (const auto& attribute : poi->attributes) {
+            picked.properties[vector_tile::attribute_keys::name(attribute.key)] = attribute.value;
         }
         if (!picked.properties.contains("ele"))
             picked.properties["ele"] = std::round(poi->lat_long_alt.z);
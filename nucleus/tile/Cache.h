@@ -18,15 +18,23 @@
 
 #pragma once
 
+#include "PackFile.h"
 #include "types.h"
 #include <QFile>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <filesystem>
+#include <limits>
 #include <mutex>
 #include <nucleus/utils/lang.h>
+#include <random>
 #include <shared_mutex>
 #include <tl/expected.hpp>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <zpp_bits.h>
 
@@ -48,7 +56,23 @@ constexpr auto serialize(auto & archive, glm::vec<2, T> & vec)
 
 namespace nucleus::tile {
 
-/// This class is thread safe. be careful with the visit method as it writes the cache and therefore locks an internal mutex.
+enum class DiskReadMode {
+    Eager, // all tiles are read on start-up
+    Lazy, // only the index is read on start-up, tiles are read when they are accessed by visit or peak_at
+};
+
+enum class EvictionPolicy {
+    Lru, // least recently visited objects are purged first
+    SizeWeightedLru, // time since the last visit times byte size decides, i.e., large objects are purged earlier
+};
+
+struct CacheBudget {
+    unsigned max_objects = std::numeric_limits<unsigned>::max();
+    uint64_t max_bytes = std::numeric_limits<uint64_t>::max();
+    EvictionPolicy policy = EvictionPolicy::Lru;
+};
+
+/// This class is thread safe. visit takes only a shared lock, several visits (and peak_at) can run concurrently.
 template<NamedTile T>
 class Cache
 {
@@ -57,46 +81,86 @@ class Cache
         uint64_t created;
     };
 
+    enum class State { InRam, OnDisk, Broken };
+
     struct CacheObject {
+        std::atomic<uint64_t> visited = 0; // written by concurrent visits, relaxed is enough as it only steers purging
+        uint64_t created = 0;
+        uint64_t cost = 0; // approximate size in bytes
+        mutable T data; // filled in on access when reading lazily
+        mutable std::atomic<State> state = State::InRam;
+        std::array<CacheObject*, 4> children = {}; // quad tree links into m_data (nodes of unordered_map are stable), in the order of Id::children()
+
+        [[nodiscard]] MetaData meta() const { return { visited.load(std::memory_order_relaxed), created }; }
+    };
+
+    struct DiskEntry {
         MetaData meta;
-        T data;
+        PackFile::Entry location;
     };
 
     std::unordered_map<tile::Id, CacheObject, tile::Id::Hasher> m_data;
     mutable std::shared_mutex m_data_mutex;
-    std::unordered_map<tile::Id, MetaData, tile::Id::Hasher> m_disk_cached;
+    std::unordered_map<tile::Id, DiskEntry, tile::Id::Hasher> m_disk_cached;
+    PackFile m_pack; // written by the writer only (m_write_mutex), remapping is protected by m_disk_cached_mutex
+    std::filesystem::path m_disk_path; // protected by m_write_mutex
+    uint64_t m_pack_generation = 0; // protected by m_write_mutex
     mutable std::shared_mutex m_disk_cached_mutex;
+    mutable std::mutex m_hydration_mutex;
+    uint64_t m_n_bytes = 0; // protected by m_data_mutex
+    std::unordered_set<tile::Id, tile::Id::Hasher> m_dirty; // inserted since the last write, protected by m_data_mutex
+    std::mutex m_write_mutex; // serialises writing and reading
 
 public:
     Cache() = default;
     void insert(const T& tile);
     [[nodiscard]] bool contains(const tile::Id& id) const;
     [[nodiscard]] unsigned n_cached_objects() const;
-    /// functor should return true, if the given tile should be marked visited. stops descending if false is returned. don't do heavy lifting in the functort, as it blocks all other access!
+    /// approximate, uses T::size_in_bytes() if available, sizeof(T) otherwise.
+    [[nodiscard]] uint64_t n_cached_bytes() const;
+    /// functor should return true, if the given tile should be marked visited. stops descending if false is returned. don't do heavy lifting in the functor,
+    /// as it blocks writing access (insert, purge)! the functor may be called concurrently from several threads visiting at the same time.
     template<typename VisitorFunction>
     void visit(const VisitorFunction& functor);
+    /// returns a tile containing only the id, if it couldn't be read back from disk.
     const T& peak_at(const tile::Id& id) const;
+    /// purged tiles, that were read lazily but not accessed yet, contain only the id.
     std::vector<T> purge(unsigned remaining_capacity);
+    std::vector<T> purge(const CacheBudget& budget);
 
+    /// tiles are stored in a single append only pack file plus an index. only tiles inserted since the last write are appended,
+    /// the pack is compacted once it holds more dead than live bytes. can be called from another thread, other accesses are
+    /// blocked only while the changes are collected.
     [[nodiscard]] tl::expected<void, QString> write_to_disk(const std::filesystem::path& path);
-    [[nodiscard]] tl::expected<void, QString> read_from_disk(const std::filesystem::path& path);
+    [[nodiscard]] tl::expected<void, QString> read_from_disk(const std::filesystem::path& path, DiskReadMode mode = DiskReadMode::Eager);
 
 private:
     template<typename VisitorFunction>
-    void visit(const tile::Id& start_node,
+    void visit(CacheObject& node,
                const VisitorFunction& functor,
                uint64_t visited_stamp); // must stay private or protected by mutex
 
-    static std::filesystem::path tile_path(const std::filesystem::path& base_path, const tile::Id& id)
-    {
-        std::string tile_name = std::to_string(id.zoom_level) + "_" + std::to_string(id.coords.x) + "_" + std::to_string(id.coords.y) + ".alp_tile";
-        return base_path / tile_name;
-    }
-
-    static std::filesystem::path meta_info_path(const std::filesystem::path& base_path)
-    {
-        return base_path / "meta_info.alp";
-    }
+    /// returns the object for id, creating and linking it into the quad tree if necessary. must be called with m_data_mutex locked.
+    CacheObject& object_for(const tile::Id& id);
+    /// must be called with m_data_mutex locked.
+    void erase_object(const tile::Id& id);
+    static unsigned child_index(const tile::Id& id);
+    static uint64_t cost_of(const T& tile);
+
+    /// reads the data of lazily loaded objects from the pack. returns false if the object is broken. must be called with m_data_mutex locked (shared is enough).
+    bool hydrate(const CacheObject& object) const;
+    /// copies the live entries into a new pack in base_path, which then replaces the current one. used for compaction and full writes.
+    /// must be called with m_write_mutex locked.
+    [[nodiscard]] tl::expected<void, QString> rewrite_pack(const std::filesystem::path& base_path);
+    /// packs start with their generation, which is stored in the index as well. a pack, that was replaced (by a full write or
+    /// compaction) after the index was written, doesn't match the index anymore. must be called with m_write_mutex locked.
+    [[nodiscard]] tl::expected<void, QString> append_pack_header(PackFile* pack);
+    static constexpr uint64_t pack_header_size = sizeof(uint64_t);
+    void reset_disk_state(); // must be called with m_disk_cached_mutex locked
+
+    static std::filesystem::path pack_path(const std::filesystem::path& base_path) { return base_path / "tiles.alp_pack"; }
+
+    static std::filesystem::path index_path(const std::filesystem::path& base_path) { return base_path / "index.alp"; }
 };
 
 using MemoryCache = nucleus::tile::Cache<nucleus::tile::DataQuad>;
@@ -106,9 +170,70 @@ void Cache<T>::insert(const T& tile)
 {
     auto locker = std::scoped_lock(m_data_mutex);
     const auto time_stamp = nucleus::utils::time_since_epoch();
-    m_data[tile.id].meta.visited = time_stamp * 100 - tile.id.zoom_level;
-    m_data[tile.id].meta.created = time_stamp;
-    m_data[tile.id].data = tile;
+    CacheObject& object = object_for(tile.id);
+    object.visited.store(time_stamp * 100 - tile.id.zoom_level, std::memory_order_relaxed);
+    object.created = time_stamp;
+    m_n_bytes -= object.cost;
+    object.cost = cost_of(tile);
+    m_n_bytes += object.cost;
+    object.data = tile;
+    object.state = State::InRam;
+    if constexpr (SerialisableTile<T>)
+        m_dirty.insert(tile.id);
+}
+
+template <NamedTile T>
+typename Cache<T>::CacheObject& Cache<T>::object_for(const tile::Id& id)
+{
+    const auto [iter, inserted] = m_data.try_emplace(id);
+    CacheObject& object = iter->second;
+    if (!inserted)
+        return object;
+
+    if (id.zoom_level > 0) {
+        const auto parent = m_data.find(id.parent());
+        if (parent != m_data.end())
+            parent->second.children[child_index(id)] = &object;
+    }
+    const auto children = id.children();
+    for (unsigned i = 0; i < 4; ++i) {
+        const auto child = m_data.find(children[i]);
+        if (child != m_data.end())
+            object.children[i] = &child->second;
+    }
+    return object;
+}
+
+template <NamedTile T>
+void Cache<T>::erase_object(const tile::Id& id)
+{
+    m_n_bytes -= m_data.at(id).cost;
+    if (id.zoom_level > 0) {
+        const auto parent = m_data.find(id.parent());
+        if (parent != m_data.end())
+            parent->second.children[child_index(id)] = nullptr;
+    }
+    m_data.erase(id);
+}
+
+template <NamedTile T>
+unsigned Cache<T>::child_index(const tile::Id& id)
+{
+    const auto siblings = id.parent().children();
+    const auto index = unsigned(std::find(siblings.cbegin(), siblings.cend(), id) - siblings.cbegin());
+    assert(index < 4);
+    return index;
+}
+
+template <NamedTile T>
+uint64_t Cache<T>::cost_of(const T& tile)
+{
+    if constexpr (requires {
+                      { tile.size_in_bytes() } -> nucleus::utils::convertible_to<uint64_t>;
+                  })
+        return tile.size_in_bytes();
+    else
+        return sizeof(T);
 }
 
 template <NamedTile T>
@@ -125,11 +250,54 @@ unsigned int Cache<T>::n_cached_objects() const
     return unsigned(m_data.size());
 }
 
+template <NamedTile T>
+uint64_t Cache<T>::n_cached_bytes() const
+{
+    auto locker = std::shared_lock(m_data_mutex);
+    return m_n_bytes;
+}
+
 template <NamedTile T>
 const T& Cache<T>::peak_at(const tile::Id& id) const
 {
     auto locker = std::shared_lock(m_data_mutex);
-    return m_data.at(id).data;
+    const auto& object = m_data.at(id);
+    hydrate(object);
+    return object.data;
+}
+
+template <NamedTile T>
+bool Cache<T>::hydrate(const CacheObject& object) const
+{
+    const auto state = object.state.load(std::memory_order_acquire);
+    if (state != State::OnDisk)
+        return state == State::InRam;
+
+    if constexpr (SerialisableTile<T>) {
+        auto locker = std::scoped_lock(m_hydration_mutex);
+        if (object.state.load(std::memory_order_relaxed) != State::OnDisk) // hydrated by another thread in the meanwhile
+            return object.state.load(std::memory_order_relaxed) == State::InRam;
+
+        auto disk_locker = std::shared_lock(m_disk_cached_mutex);
+        const auto entry = m_disk_cached.find(object.data.id);
+        if (entry == m_disk_cached.end() || entry->second.meta.created != object.created) {
+            object.state.store(State::Broken, std::memory_order_release);
+            return false;
+        }
+
+        const auto bytes = m_pack.view(entry->second.location);
+        zpp::bits::in in(bytes);
+        T data;
+        if (failure(in(data)) || data.id != object.data.id) {
+            object.state.store(State::Broken, std::memory_order_release);
+            return false;
+        }
+        object.data = std::move(data);
+        object.state.store(State::InRam, std::memory_order_release);
+        return true;
+    } else {
+        return false;
+    }
 }
 
 template <NamedTile T> tl::expected<void, QString> Cache<T>::write_to_disk(const std::filesystem::path& base_path)
@@ -137,91 +305,197 @@ template <NamedTile T> tl::expected<void, QString> Cache<T>::write_to_disk(const
     const auto unexpected_error = [](const auto& e) { return tl::unexpected(QString::fromStdString(std::make_error_code(e).message())); };
     static_assert(SerialisableTile<T>);
     std::filesystem::create_directories(base_path);
-    std::unordered_map<tile::Id, CacheObject, tile::Id::Hasher> data;
-    {
-        auto locker = std::scoped_lock(m_data_mutex);
-        data = m_data; // copies only metadata and references to tiles
-    }
-    auto locker = std::scoped_lock(m_disk_cached_mutex);
 
-    const auto write = [](const auto& bytes, const auto& path) -> tl::expected<void, QString> {
-        QFile file(path);
-        const auto success = file.open(QIODeviceBase::WriteOnly);
-        if (!success)
-            return tl::unexpected<QString>(QString("Couldn't open file '%1' for writing!").arg(QString::fromStdString(path.string())));
-        file.write(bytes.data(), qint64(bytes.size()));
-        return {};
+    // only the writer modifies the disk state. it reads it without locking and takes m_disk_cached_mutex only for
+    // modifications, so that lazy reading (hydrate) is not blocked during I/O.
+    auto write_locker = std::scoped_lock(m_write_mutex);
+    const auto fail = [this](const QString& message) {
+        auto locker = std::scoped_lock(m_disk_cached_mutex);
+        reset_disk_state();
+        return tl::unexpected(message);
     };
 
-    std::unordered_map<tile::Id, MetaData, tile::Id::Hasher> disk_cached_old;
-    std::swap(m_disk_cached, disk_cached_old);
-    m_disk_cached.reserve(data.size());
+    const auto full_write = m_disk_path != base_path || !m_pack.is_open() || !std::filesystem::exists(pack_path(base_path));
 
-    // removing disk cache items, that were removed or updated in ram
-    for (const auto& item : disk_cached_old) {
-        const tile::Id& id = item.first;
-        const MetaData& meta = item.second;
-        if (data.contains(id) && data.at(id).meta.created == meta.created) {
-            continue;
+    // snapshot of the changes since the last write. copies only metadata and references to tiles.
+    std::vector<T> changed;
+    std::unordered_map<tile::Id, std::pair<MetaData, State>, tile::Id::Hasher> current;
+    {
+        auto locker = std::scoped_lock(m_data_mutex);
+        const auto add_changed = [&changed](const CacheObject& object) {
+            if (object.state == State::InRam) // lazily read objects are in the pack already (and are copied on a full write)
+                changed.push_back(object.data);
+        };
+        if (full_write) {
+            changed.reserve(m_data.size());
+            for (const auto& item : m_data)
+                add_changed(item.second);
+        } else {
+            changed.reserve(m_dirty.size());
+            for (const auto& id : m_dirty)
+                add_changed(m_data.at(id));
         }
-        std::filesystem::remove(tile_path(base_path, id));
+        m_dirty.clear();
+        current.reserve(m_data.size());
+        for (const auto& [id, object] : m_data)
+            current[id] = { object.meta(), object.state.load() };
     }
 
-        // write new or updated items to disk
-        for (const auto& item : data) {
-            const tile::Id& id = item.first;
-            const CacheObject& cache_object = item.second;
-            m_disk_cached[id] = cache_object.meta;
-
-            if (disk_cached_old.contains(id) && disk_cached_old.at(id).created == cache_object.meta.created)
-                continue;
-
-            std::vector<char> bytes;
-            zpp::bits::out out(bytes);
-            const std::remove_cvref_t<decltype(T::version_information)> version = T::version_information;
-            {
-                const auto r = out(version);
-                if (failure(r))
-                    return unexpected_error(r);
-            }
-            {
-                const auto r = out(cache_object.data);
-                if (failure(r))
-                    return unexpected_error(r);
-            }
-            {
-                const auto r = write(bytes, tile_path(base_path, id));
-                if (!r.has_value())
-                    return r;
-            }
+    {
+        auto locker = std::scoped_lock(m_disk_cached_mutex);
+        // drop items that were purged (or couldn't be read back), and update visit stamps, so that purging continues where it left off.
+        // on a full write, items in ram are written anew.
+        std::erase_if(m_disk_cached, [&current, full_write](const auto& item) {
+            const auto object = current.find(item.first);
+            return object == current.end() || object->second.second == State::Broken || (full_write && object->second.second == State::InRam);
+        });
+        for (auto& [id, entry] : m_disk_cached) {
+            const auto& meta = current.at(id).first;
+            if (meta.created == entry.meta.created)
+                entry.meta.visited = meta.visited;
         }
+    }
+    if (full_write) {
+        // lazily read items, that were never accessed, exist only in the current pack (which might be deleted or in another
+        // directory already, but is still mapped). they are copied into the new pack, which replaces the current one once it
+        // is complete, so that they can be read lazily in the meanwhile.
+        const auto r = rewrite_pack(base_path);
+        if (!r.has_value())
+            return fail(r.error());
+    }
 
+    // append new or updated items, their old versions become dead bytes in the pack
+    std::vector<std::pair<tile::Id, DiskEntry>> appended;
+    appended.reserve(changed.size());
+    for (const auto& tile : changed) {
         std::vector<char> bytes;
         zpp::bits::out out(bytes);
-        const std::remove_cvref_t<decltype(T::version_information)> version = T::version_information;
         {
-            const auto r = out(version);
+            const auto r = out(tile);
             if (failure(r))
-                return unexpected_error(r);
+                return fail(unexpected_error(r).value());
         }
+        const auto location = m_pack.append(bytes);
+        if (!location.has_value())
+            return fail(location.error());
+        appended.emplace_back(tile.id, DiskEntry { current.at(tile.id).first, location.value() });
+    }
+    {
+        auto locker = std::scoped_lock(m_disk_cached_mutex);
+        const auto r = m_pack.flush();
+        if (!r.has_value()) {
+            reset_disk_state();
+            return r;
+        }
+        for (const auto& [id, entry] : appended)
+            m_disk_cached[id] = entry;
+    }
+
+    uint64_t live_bytes = 0;
+    for (const auto& item : m_disk_cached)
+        live_bytes += item.second.location.size;
+    if (m_pack.size() - pack_header_size - live_bytes > live_bytes) {
+        const auto r = rewrite_pack(m_disk_path);
+        if (!r.has_value())
+            return fail(r.error());
+    }
+
+    std::vector<char> bytes;
+    zpp::bits::out out(bytes);
+    const std::remove_cvref_t<decltype(T::version_information)> version = T::version_information;
+    const uint64_t pack_size = m_pack.size();
+    {
+        const auto r = out(version, m_pack_generation, pack_size, m_disk_cached);
+        if (failure(r))
+            return fail(unexpected_error(r).value());
+    }
+
+    // the index is written after the pack and replaced atomically, so it never references bytes that are not on disk.
+    auto tmp_path = index_path(base_path);
+    tmp_path += ".tmp";
+    {
+        QFile file(tmp_path);
+        if (!file.open(QIODeviceBase::WriteOnly) || file.write(bytes.data(), qint64(bytes.size())) != qint64(bytes.size()))
+            return fail(QString("Couldn't write file '%1'!").arg(QString::fromStdString(tmp_path.string())));
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, index_path(base_path), ec);
+    if (ec)
+        return fail(QString::fromStdString(ec.message()));
+
+    return {};
+}
 
+template <NamedTile T> tl::expected<void, QString> Cache<T>::rewrite_pack(const std::filesystem::path& base_path)
+{
+    auto rewritten_path = pack_path(base_path);
+    rewritten_path += ".tmp";
+
+    auto disk_cached = m_disk_cached;
+    {
+        PackFile rewritten;
         {
-            const auto r = out(m_disk_cached);
-            if (failure(r))
-                return unexpected_error(r);
+            const auto r = rewritten.open(rewritten_path, true);
+            if (!r.has_value())
+                return r;
         }
-
-        const auto r = write(bytes, meta_info_path(base_path));
+        {
+            const auto r = append_pack_header(&rewritten);
+            if (!r.has_value())
+                return r;
+        }
+        for (auto& item : disk_cached) {
+            const auto bytes = m_pack.view(item.second.location);
+            if (bytes.size() != item.second.location.size)
+                return tl::unexpected(QString("Pack file '%1' is corrupt!").arg(QString::fromStdString(m_pack.path().string())));
+            const auto location = rewritten.append(bytes);
+            if (!location.has_value())
+                return tl::unexpected(location.error());
+            item.second.location = location.value();
+        }
+        const auto r = rewritten.flush();
         if (!r.has_value())
             return r;
+    }
 
-        return {};
+    auto locker = std::scoped_lock(m_disk_cached_mutex);
+    m_pack.close();
+    std::error_code ec;
+    std::filesystem::rename(rewritten_path, pack_path(base_path), ec);
+    if (ec)
+        return tl::unexpected(QString::fromStdString(ec.message()));
+    m_disk_cached = std::move(disk_cached);
+    m_disk_path = base_path;
+    return m_pack.open(pack_path(base_path));
+}
+
+template <NamedTile T> tl::expected<void, QString> Cache<T>::append_pack_header(PackFile* pack)
+{
+    assert(pack->size() == 0);
+    // random, so that packs written by other instances (or processes) differ as well
+    std::random_device random;
+    do {
+        m_pack_generation = (uint64_t(random()) << 32) ^ uint64_t(random());
+    } while (m_pack_generation == 0);
+    std::array<char, pack_header_size> bytes;
+    std::memcpy(bytes.data(), &m_pack_generation, bytes.size());
+    const auto location = pack->append(bytes);
+    if (!location.has_value())
+        return tl::unexpected(location.error());
+    return {};
 }
 
-template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(const std::filesystem::path& base_path)
+template <NamedTile T> void Cache<T>::reset_disk_state()
+{
+    m_pack.close();
+    m_disk_cached.clear();
+    m_disk_path.clear();
+}
+
+template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(const std::filesystem::path& base_path, DiskReadMode mode)
 {
     const auto unexpected_error = [](const auto& e) { return tl::unexpected(QString::fromStdString(std::make_error_code(e).message())); };
-    auto locker = std::scoped_lock(m_data_mutex, m_disk_cached_mutex);
+    auto locker = std::scoped_lock(m_write_mutex, m_data_mutex, m_disk_cached_mutex);
     assert(SerialisableTile<T>);
     const auto check_version = [&unexpected_error](auto* in, const auto& path) -> tl::expected<void, QString> {
         std::remove_cvref_t<decltype(T::version_information)> version_info = {};
@@ -241,27 +515,23 @@ template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(cons
         }
         return {};
     };
-    const auto read_all = [](const auto& path) -> tl::expected<QByteArray, QString> {
-        QFile file(path);
-        const auto success = file.open(QIODeviceBase::ReadOnly);
-        if (!success)
-            return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(QString::fromStdString(path.string())));
-        return file.readAll();
-    };
     const auto clean_up = [&]() {
-        m_disk_cached.clear();
+        reset_disk_state();
         m_data.clear();
+        m_n_bytes = 0;
+        m_dirty.clear();
     };
 
     clean_up();
+    uint64_t generation = 0;
+    uint64_t pack_size = 0;
     {
-        const auto path = meta_info_path(base_path);
-        const auto bytes = read_all(path);
-        if (!bytes.has_value()) {
-            clean_up();
-            return tl::unexpected(bytes.error());
-        }
-        zpp::bits::in in(bytes.value());
+        const auto path = index_path(base_path);
+        QFile file(path);
+        if (!file.open(QIODeviceBase::ReadOnly))
+            return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(QString::fromStdString(path.string())));
+        const auto bytes = file.readAll();
+        zpp::bits::in in(bytes);
         {
             const auto r = check_version(&in, path);
             if (!r.has_value()) {
@@ -270,34 +540,60 @@ template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(cons
             }
         }
         {
-            const auto r = in(m_disk_cached);
+            const auto r = in(generation, pack_size, m_disk_cached);
             if (failure(r)) {
                 clean_up();
                 return unexpected_error(r);
             }
         }
     }
+    {
+        const auto path = pack_path(base_path);
+        if (!std::filesystem::exists(path)) {
+            clean_up();
+            return tl::unexpected(QString("Pack file '%1' is missing!").arg(QString::fromStdString(path.string())));
+        }
+        const auto r = m_pack.open(path);
+        if (!r.has_value()) {
+            clean_up();
+            return r;
+        }
+        // a crash between appending to (or compacting) the pack and writing the index leaves a pack of a different size.
+        // appended bytes are harmless, a shorter pack means the index is stale.
+        if (m_pack.size() < pack_size) {
+            clean_up();
+            return tl::unexpected(QString("Pack file '%1' is smaller than expected by its index!").arg(QString::fromStdString(path.string())));
+        }
+        // a crash between replacing the pack and writing the index leaves a pack of another generation.
+        const auto header = m_pack.view({ 0, pack_header_size });
+        uint64_t pack_generation = 0;
+        if (header.size() == pack_header_size)
+            std::memcpy(&pack_generation, header.data(), header.size());
+        if (pack_generation != generation) {
+            clean_up();
+            return tl::unexpected(QString("Pack file '%1' doesn't belong to its index!").arg(QString::fromStdString(path.string())));
+        }
+        m_pack_generation = generation;
+    }
 
+    m_data.reserve(m_disk_cached.size());
     for (const auto& entry : m_disk_cached) {
         const tile::Id& id = entry.first;
-        const MetaData& meta = entry.second;
-
-        const auto path = tile_path(base_path, id);
-        const auto bytes = read_all(path);
-        if (!bytes.has_value()) {
-            clean_up();
-            return tl::unexpected(bytes.error());
-        }
-        zpp::bits::in in(bytes.value());
-        {
-            const auto r = check_version(&in, path);
-            if (!r.has_value()) {
-                clean_up();
-                return r;
-            }
+        const DiskEntry& disk_entry = entry.second;
+
+        CacheObject& d = object_for(id);
+        d.visited.store(disk_entry.meta.visited, std::memory_order_relaxed);
+        d.created = disk_entry.meta.created;
+        if (mode == DiskReadMode::Lazy) {
+            d.data.id = id;
+            d.state = State::OnDisk;
+            d.cost = sizeof(T) + disk_entry.location.size; // the serialised size is a good estimate
+            m_n_bytes += d.cost;
+            continue;
         }
 
-        CacheObject d;
+        const auto bytes = m_pack.view(disk_entry.location);
+        zpp::bits::in in(bytes);
         {
             const auto r = in(d.data);
             if (failure(r)) {
@@ -305,9 +601,14 @@ template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(cons
                 return unexpected_error(r);
             }
         }
-        d.meta = meta;
-        m_data[d.data.id] = d;
+        if (d.data.id != id) {
+            clean_up();
+            return tl::unexpected(QString("Pack file '%1' doesn't match its index!").arg(QString::fromStdString(pack_path(base_path).string())));
+        }
+        d.cost = cost_of(d.data);
+        m_n_bytes += d.cost;
     }
+    m_disk_path = base_path;
 
     return {};
 }
@@ -316,51 +617,114 @@ template <NamedTile T>
 template <typename VisitorFunction>
 void Cache<T>::visit(const VisitorFunction& functor)
 {
-    auto locker = std::scoped_lock(m_data_mutex);
+    auto locker = std::shared_lock(m_data_mutex);
     const auto visited = nucleus::utils::time_since_epoch();
     static_assert(
         requires {
             { functor(T()) } -> nucleus::utils::convertible_to<bool>;
         }, "VisitorFunction must accept a const NamedTile and return a bool.");
-    const auto root = tile::Id { 0, { 0, 0 } };
-    visit(root, functor, visited);
+    const auto root = m_data.find(tile::Id { 0, { 0, 0 } });
+    if (root != m_data.end())
+        visit(root->second, functor, visited);
 }
 
 template <NamedTile T>
 template <typename VisitorFunction>
-void Cache<T>::visit(const tile::Id& node, const VisitorFunction& functor, uint64_t visited_stamp)
+void Cache<T>::visit(CacheObject& node, const VisitorFunction& functor, uint64_t visited_stamp)
 {
     static_assert(requires {
         { functor(T()) } -> nucleus::utils::convertible_to<bool>;
     });
-    if (m_data.contains(node)) {
-        const auto should_continue = functor(m_data[node].data);
-        if (!should_continue)
-            return;
-        m_data[node].meta.visited = visited_stamp * 100 - m_data[node].data.id.zoom_level;
-        const auto children = node.children();
-        for (const auto& id : children) {
-            visit(id, functor, visited_stamp);
-        }
+    if (!hydrate(node))
+        return;
+    const auto should_continue = functor(std::as_const(node.data));
+    if (!should_continue)
+        return;
+    node.visited.store(visited_stamp * 100 - node.data.id.zoom_level, std::memory_order_relaxed);
+    for (CacheObject* child : node.children) {
+        if (child)
+            visit(*child, functor, visited_stamp);
     }
 }
 
-template<NamedTile T>
+template <NamedTile T>
 std::vector<T> Cache<T>::purge(unsigned remaining_capacity)
+{
+    return purge(CacheBudget { remaining_capacity });
+}
+
+template <NamedTile T>
+std::vector<T> Cache<T>::purge(const CacheBudget& budget)
 {
     auto locker = std::scoped_lock(m_data_mutex);
-    if (remaining_capacity >= m_data.size())
+    if (m_data.size() <= budget.max_objects && m_n_bytes <= budget.max_bytes)
         return {};
-    std::vector<std::pair<tile::Id, uint64_t>> tiles;
+
+    struct Candidate {
+        tile::Id id;
+        uint64_t visited;
+        uint64_t cost;
+        bool kept = false;
+    };
+    std::vector<Candidate> tiles;
     tiles.reserve(m_data.size());
-    std::transform(m_data.cbegin(), m_data.cend(), std::back_inserter(tiles), [](const auto& entry) { return std::make_pair(entry.first, entry.second.meta.visited); });
-    const auto nth_iter = tiles.begin() + remaining_capacity;
-    std::nth_element(tiles.begin(), nth_iter, tiles.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::transform(m_data.cbegin(), m_data.cend(), std::back_inserter(tiles), [](const auto& entry) {
+        return Candidate { entry.first, entry.second.visited.load(std::memory_order_relaxed), entry.second.cost };
+    });
+
+    auto first_purged = tiles.end();
+    const auto by_recency = [](const Candidate& a, const Candidate& b) { return a.visited > b.visited; };
+    if (budget.policy == EvictionPolicy::Lru && budget.max_bytes == std::numeric_limits<uint64_t>::max()) {
+        first_purged = tiles.begin() + budget.max_objects;
+        std::nth_element(tiles.begin(), first_purged, tiles.end(), by_recency);
+    } else {
+        if (budget.policy == EvictionPolicy::Lru) {
+            std::sort(tiles.begin(), tiles.end(), by_recency);
+        } else {
+            const auto newest = std::max_element(tiles.cbegin(), tiles.cend(), [](const auto& a, const auto& b) { return a.visited < b.visited; })->visited;
+            const auto score = [newest](const Candidate& c) { return double(newest - c.visited + 1) * double(c.cost); };
+            std::sort(tiles.begin(), tiles.end(), [&score](const Candidate& a, const Candidate& b) { return score(a) < score(b); });
+        }
+        std::unordered_map<tile::Id, size_t, tile::Id::Hasher> index_of;
+        index_of.reserve(tiles.size());
+        for (size_t i = 0; i < tiles.size(); ++i)
+            index_of[tiles[i].id] = i;
+
+        // keep in order of priority, until the first object doesn't fit anymore. objects are reachable only through their
+        // ancestors, so these are kept (and accounted for) along with them, even if they have a lower priority.
+        uint64_t n_bytes = 0;
+        size_t n_objects = 0;
+        std::vector<size_t> lineage;
+        for (const auto& candidate : tiles) {
+            if (candidate.kept)
+                continue;
+            lineage.clear();
+            uint64_t lineage_cost = 0;
+            for (auto id = candidate.id;; id = id.parent()) {
+                const auto iter = index_of.find(id);
+                if (iter == index_of.end() || tiles[iter->second].kept)
+                    break;
+                lineage.push_back(iter->second);
+                lineage_cost += tiles[iter->second].cost;
+                if (id.zoom_level == 0)
+                    break;
+            }
+            if (n_objects + lineage.size() > budget.max_objects || lineage_cost > budget.max_bytes - n_bytes)
+                break;
+            for (const auto i : lineage)
+                tiles[i].kept = true;
+            n_objects += lineage.size();
+            n_bytes += lineage_cost;
+        }
+        first_purged = std::partition(tiles.begin(), tiles.end(), [](const Candidate& c) { return c.kept; });
+    }
+
     std::vector<T> purged_tiles;
-    purged_tiles.reserve(tiles.size() - remaining_capacity);
-    std::for_each(nth_iter, tiles.end(), [this, &purged_tiles](const auto& v) {
-        purged_tiles.push_back(m_data[v.first].data);
-        m_data.erase(v.first);
+    purged_tiles.reserve(size_t(tiles.end() - first_purged));
+    std::for_each(first_purged, tiles.end(), [this, &purged_tiles](const Candidate& c) {
+        purged_tiles.push_back(m_data.at(c.id).data);
+        erase_object(c.id);
+        m_dirty.erase(c.id);
     });
     return purged_tiles;
 }
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "ConcurrencyController.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace nucleus::tile;
+
+ConcurrencyController::ConcurrencyController()
+    : ConcurrencyController(Settings {})
+{
+}
+
+ConcurrencyController::ConcurrencyController(const Settings& settings)
+    : m(settings)
+    , m_window(float(std::clamp(settings.initial_limit, settings.min_limit, settings.max_limit)))
+{
+    assert(m.min_limit > 0 && m.min_limit <= m.max_limit);
+    assert(m.base_rtt_window > 0);
+}
+
+bool ConcurrencyController::can_start() const { return m_in_flight < limit(); }
+
+ConcurrencyController::Ticket ConcurrencyController::start()
+{
+    ++m_in_flight;
+    return m_next_ticket++;
+}
+
+void ConcurrencyController::finish(Ticket ticket, std::optional<unsigned> rtt_msecs, bool failed)
+{
+    assert(m_in_flight > 0);
+    const auto window_is_used = m_in_flight * 2 >= limit();
+    --m_in_flight;
+
+    m_error_rate += (float(failed) - m_error_rate) * 0.1f;
+    if (!failed && !rtt_msecs)
+        return;
+
+    const auto rtt = float(rtt_msecs.value_or(0));
+    if (!failed) {
+        m_smoothed_rtt = m_smoothed_rtt < 0 ? rtt : m_smoothed_rtt + (rtt - m_smoothed_rtt) * 0.125f;
+        m_rtt_window_min = std::min(m_rtt_window_min, rtt);
+        if (++m_n_rtt_window_samples >= m.base_rtt_window) {
+            m_previous_rtt_window_min = m_rtt_window_min;
+            m_rtt_window_min = std::numeric_limits<float>::infinity();
+            m_n_rtt_window_samples = 0;
+        }
+    }
+
+    const auto congested = failed || rtt > m.latency_tolerance * std::max(base_rtt(), 1.0f);
+    if (congested) {
+        if (ticket >= m_recovery_ticket) {
+            m_window = std::max(float(m.min_limit), m_window * m.decrease_factor);
+            m_recovery_ticket = m_next_ticket;
+        }
+        return;
+    }
+    // growing is pointless when far fewer requests are issued than allowed
+    if (window_is_used)
+        m_window = std::min(float(m.max_limit), m_window + 1.0f / m_window);
+}
+
+unsigned ConcurrencyController::limit() const { return unsigned(m_window); }
+
+unsigned ConcurrencyController::in_flight() const { return m_in_flight; }
+
+float ConcurrencyController::smoothed_rtt() const { return m_smoothed_rtt; }
+
+float ConcurrencyController::base_rtt() const
+{
+    const auto base = std::min(m_rtt_window_min, m_previous_rtt_window_min);
+    return base == std::numeric_limits<float>::infinity() ? -1.0f : base;
+}
+
+float ConcurrencyController::error_rate() const { return m_error_rate; }
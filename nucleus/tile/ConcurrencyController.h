@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace nucleus::tile {
+
+/// AIMD controller for the number of requests in flight to one host. The window grows by about one slot per window of
+/// successful requests and shrinks multiplicatively on errors or when round trips get much slower than the base round trip
+/// time (i.e., when the queues on the way start to fill up). The base round trip time is the minimum over the last one to two
+/// base_rtt_window samples, so that it adapts when the route or link changes. Shrinking happens at most once per window, requests that were
+/// started before the last decrease don't decrease it again. Pure logic, time is passed in.
+class ConcurrencyController {
+public:
+    struct Settings {
+        unsigned min_limit = 2;
+        unsigned max_limit = 64;
+        unsigned initial_limit = 64; // requests weren't limited before, start there and back off only on congestion
+        float latency_tolerance = 3.0f; // round trips longer than this multiple of the base round trip count as congestion
+        float decrease_factor = 0.7f;
+        unsigned base_rtt_window = 256; // samples
+    };
+    using Ticket = uint64_t;
+
+    ConcurrencyController();
+    explicit ConcurrencyController(const Settings& settings);
+
+    [[nodiscard]] bool can_start() const;
+    Ticket start();
+    /// failed should be set for network errors and timeouts, not for missing tiles.
+    /// rtt_msecs should be empty for replies that say nothing about the link, e.g., cache hits or missing tiles. they neither grow nor shrink the window.
+    void finish(Ticket ticket, std::optional<unsigned> rtt_msecs, bool failed);
+
+    [[nodiscard]] unsigned limit() const;
+    [[nodiscard]] unsigned in_flight() const;
+    /// msecs, negative until the first successful request
+    [[nodiscard]] float smoothed_rtt() const;
+    /// msecs, windowed minimum of the round trip time. negative until the first successful request
+    [[nodiscard]] float base_rtt() const;
+    /// exponentially weighted fraction of failed requests
+    [[nodiscard]] float error_rate() const;
+
+private:
+    Settings m;
+    float m_window;
+    unsigned m_in_flight = 0;
+    Ticket m_next_ticket = 0;
+    Ticket m_recovery_ticket = 0;
+    float m_smoothed_rtt = -1;
+    float m_rtt_window_min = std::numeric_limits<float>::infinity();
+    float m_previous_rtt_window_min = std::numeric_limits<float>::infinity();
+    unsigned m_n_rtt_window_samples = 0;
+    float m_error_rate = 0;
+};
+
+} // namespace nucleus::tile
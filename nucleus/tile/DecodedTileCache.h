@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include "types.h"
+#include <QVariantMap>
+#include <list>
+#include <unordered_map>
+
+namespace nucleus::tile {
+
+/// Byte bounded LRU cache for decoded (and compressed) gpu payloads, so that quads moving back onto the gpu don't need to be decoded again.
+/// Entries are keyed by tile id and a stamp of the source data (e.g., the network timestamp), so that refreshed tiles are decoded anew.
+/// Payload is meant to be a shared_ptr to const data. Not thread safe.
+template <typename Payload>
+class DecodedTileCache {
+    struct Entry {
+        tile::Id id;
+        uint64_t stamp;
+        Payload payload;
+        uint64_t n_bytes;
+    };
+
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<tile::Id, typename std::list<Entry>::iterator, tile::Id::Hasher> m_index;
+    uint64_t m_byte_limit;
+    uint64_t m_n_bytes = 0;
+    uint64_t m_n_hits = 0;
+    uint64_t m_n_misses = 0;
+
+public:
+    explicit DecodedTileCache(uint64_t byte_limit)
+        : m_byte_limit(byte_limit)
+    {
+    }
+
+    /// returns an empty payload on a miss, or if the cached payload was created from different data.
+    [[nodiscard]] Payload get(const tile::Id& id, uint64_t stamp)
+    {
+        const auto iter = m_index.find(id);
+        if (iter == m_index.end() || iter->second->stamp != stamp) {
+            ++m_n_misses;
+            return {};
+        }
+        ++m_n_hits;
+        m_entries.splice(m_entries.begin(), m_entries, iter->second);
+        return iter->second->payload;
+    }
+
+    void put(const tile::Id& id, uint64_t stamp, Payload payload, uint64_t n_bytes)
+    {
+        remove(id);
+        if (n_bytes > m_byte_limit)
+            return;
+        m_entries.push_front({ id, stamp, std::move(payload), n_bytes });
+        m_index[id] = m_entries.begin();
+        m_n_bytes += n_bytes;
+        shrink_to_limit();
+    }
+
+    void remove(const tile::Id& id)
+    {
+        const auto iter = m_index.find(id);
+        if (iter == m_index.end())
+            return;
+        m_n_bytes -= iter->second->n_bytes;
+        m_entries.erase(iter->second);
+        m_index.erase(iter);
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_index.clear();
+        m_n_bytes = 0;
+    }
+
+    void set_byte_limit(uint64_t byte_limit)
+    {
+        m_byte_limit = byte_limit;
+        shrink_to_limit();
+    }
+
+    [[nodiscard]] size_t size() const { return m_entries.size(); }
+    [[nodiscard]] uint64_t n_bytes() const { return m_n_bytes; }
+    [[nodiscard]] uint64_t n_hits() const { return m_n_hits; }
+    [[nodiscard]] uint64_t n_misses() const { return m_n_misses; }
+
+    [[nodiscard]] QVariantMap statistics() const
+    {
+        QVariantMap stats;
+        stats["n_decoded_cache_hits"] = quint64(m_n_hits);
+        stats["n_decoded_cache_misses"] = quint64(m_n_misses);
+        stats["n_decoded_cache_bytes"] = quint64(m_n_bytes);
+        return stats;
+    }
+
+private:
+    void shrink_to_limit()
+    {
+        while (m_n_bytes > m_byte_limit) {
+            m_n_bytes -= m_entries.back().n_bytes;
+            m_index.erase(m_entries.back().id);
+            m_entries.pop_back();
+        }
+    }
+};
+
+} // namespace nucleus::tile
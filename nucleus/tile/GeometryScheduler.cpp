@@ -20,15 +20,15 @@
 
 #include "utils.h"
 #include <QDebug>
-#include <nucleus/tile/conversion.h>
-#include <nucleus/utils/error.h>
 #include <nucleus/utils/image_loader.h>
+#include <nucleus/utils/thread.h>
 
 namespace nucleus::tile {
 
 GeometryScheduler::GeometryScheduler(const Settings& settings, unsigned int height_map_size)
     : nucleus::tile::Scheduler(settings)
     , m_default_raster(glm::uvec2(height_map_size), uint16_t(0))
+    , m_decoded_cache(settings.decoded_cache_byte_limit)
 {
 }
 
@@ -39,6 +39,7 @@ void GeometryScheduler::transform_and_emit(const std::vector<tile::DataQuad>& ne
     // Tested larger geometry tiles (129x129) and switched back to smaller ones (65x65) for performance reasons (smaller ones are twice as fast).
     std::vector<GpuGeometryTile> new_gpu_tiles;
     new_gpu_tiles.reserve(new_quads.size() * 4);
+    std::vector<std::pair<size_t, const tile::Data*>> to_decode; // index into new_gpu_tiles and source
 
     for (const auto& quad : new_quads) {
         for (const auto& tile : quad.tiles) {
@@ -46,9 +47,9 @@ void GeometryScheduler::transform_and_emit(const std::vector<tile::DataQuad>& ne
             gpu_tile.id = tile.id;
             if (tile.data->size()) {
                 // tile is available
-                using namespace nucleus::utils;
-                gpu_tile.surface = std::make_shared<const nucleus::Raster<uint16_t>>(
-                    image_loader::rgba8(*tile.data).and_then(error::wrap_to_expected(conversion::to_u16raster)).value_or(m_default_raster));
+                gpu_tile.surface = m_decoded_cache.get(tile.id, tile.network_info.timestamp);
+                if (!gpu_tile.surface)
+                    to_decode.emplace_back(new_gpu_tiles.size(), &tile);
             } else {
                 // tile is not available (use default tile)
                 gpu_tile.surface = std::make_shared<const nucleus::Raster<uint16_t>>(m_default_raster);
@@ -57,6 +58,16 @@ void GeometryScheduler::transform_and_emit(const std::vector<tile::DataQuad>& ne
         }
     }
 
+    // decoding runs in parallel, the decoded cache is only touched from this thread.
+    nucleus::utils::thread::parallel_for(to_decode.size(), [&](size_t i) {
+        using namespace nucleus::utils;
+        const auto& [index, tile] = to_decode[i];
+        new_gpu_tiles[index].surface = std::make_shared<const nucleus::Raster<uint16_t>>(
+            image_loader::rg8_as_u16(*tile->data).value_or(m_default_raster));
+    });
+    for (const auto& [index, tile] : to_decode)
+        m_decoded_cache.put(tile->id, tile->network_info.timestamp, new_gpu_tiles[index].surface, new_gpu_tiles[index].surface->size_in_bytes());
+
     std::vector<tile::Id> deleted_tiles;
     deleted_tiles.reserve(deleted_quads.size() * 4);
     for (const auto& id : deleted_quads) {
@@ -66,6 +77,7 @@ void GeometryScheduler::transform_and_emit(const std::vector<tile::DataQuad>& ne
     }
 
     emit gpu_tiles_updated(deleted_tiles, new_gpu_tiles);
+    emit stats_ready(name(), m_decoded_cache.statistics());
 }
 
 } // namespace nucleus::tile
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "DecodedTileCache.h"
 #include "Scheduler.h"
 #include "types.h"
 
@@ -40,6 +41,7 @@ protected:
 
 private:
     Raster<uint16_t> m_default_raster;
+    DecodedTileCache<std::shared_ptr<const nucleus::Raster<uint16_t>>> m_decoded_cache;
 };
 
 } // namespace nucleus::tile
@@ -0,0 +1,139 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "LoadBalancer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using namespace nucleus::tile;
+
+namespace {
+uint32_t mix(uint32_t hash, uint32_t target)
+{
+    // murmur3 finaliser
+    uint32_t h = hash ^ (target * 0x9e3779b9u);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+} // namespace
+
+LoadBalancer::LoadBalancer(size_t n_targets)
+    : LoadBalancer(n_targets, Settings {})
+{
+}
+
+LoadBalancer::LoadBalancer(size_t n_targets, const Settings& settings)
+    : m(settings)
+    , m_targets(std::max(n_targets, size_t(1)))
+{
+}
+
+unsigned LoadBalancer::select(uint32_t hash, uint64_t now_msecs, std::optional<unsigned> exclude) const
+{
+    const auto affine = affine_target(hash);
+    if (m_targets.size() == 1 || (affine != exclude && is_healthy(affine, now_msecs)))
+        return affine;
+
+    // weighted rendezvous hashing over the healthy targets keeps the replacement stable per tile
+    std::optional<unsigned> best;
+    float best_score = -1;
+    for (unsigned i = 0; i < m_targets.size(); ++i) {
+        if (i == exclude || !is_healthy(i, now_msecs))
+            continue;
+        const auto u = (float(mix(hash, i)) + 1.0f) / (float(std::numeric_limits<uint32_t>::max()) + 2.0f); // (0, 1)
+        const auto score = weight(i, now_msecs) / -std::log(u);
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    if (best)
+        return *best;
+    // nothing healthy (left), stay with the affine target, or the one after it for retries
+    return affine == exclude ? unsigned((affine + 1) % m_targets.size()) : affine;
+}
+
+void LoadBalancer::report(unsigned target, unsigned rtt_msecs, bool failed, uint64_t now_msecs)
+{
+    assert(target < m_targets.size());
+    auto& t = m_targets[target];
+    t.error_rate += (float(failed) - t.error_rate) * 0.1f;
+    if (!failed) {
+        const auto rtt = float(rtt_msecs);
+        t.smoothed_rtt = t.smoothed_rtt < 0 ? rtt : t.smoothed_rtt + (rtt - t.smoothed_rtt) * 0.125f;
+        ++t.n_samples;
+    }
+    if (m_targets.size() == 1 || now_msecs < t.ejected_until)
+        return;
+
+    const auto fastest = fastest_rtt(now_msecs);
+    const auto slow = t.n_samples >= m.min_samples && fastest > 0 && t.smoothed_rtt > m.max_rtt_ratio * fastest;
+    if (t.error_rate > m.max_error_rate || slow) {
+        t.ejected_until = now_msecs + m.ejection_msecs;
+        // the statistics are partially forgotten, so that the target is judged anew after the ejection
+        t.error_rate = m.max_error_rate * 0.5f;
+        t.smoothed_rtt = -1;
+        t.n_samples = 0;
+    }
+}
+
+size_t LoadBalancer::n_targets() const { return m_targets.size(); }
+
+bool LoadBalancer::is_healthy(unsigned target, uint64_t now_msecs) const
+{
+    assert(target < m_targets.size());
+    return now_msecs >= m_targets[target].ejected_until;
+}
+
+const LoadBalancer::TargetHealth& LoadBalancer::health(unsigned target) const
+{
+    assert(target < m_targets.size());
+    return m_targets[target];
+}
+
+unsigned LoadBalancer::affine_target(uint32_t hash) const
+{
+    const auto index = unsigned((float(hash % 1024) / 1024.1f) * float(m_targets.size()));
+    assert(index < m_targets.size());
+    return index;
+}
+
+float LoadBalancer::weight(unsigned target, uint64_t now_msecs) const
+{
+    const auto& t = m_targets[target];
+    const auto rtt = t.smoothed_rtt > 0 ? t.smoothed_rtt : fastest_rtt(now_msecs); // unknown targets count as fast
+    return (1.0f - t.error_rate) / std::max(rtt, 1.0f);
+}
+
+float LoadBalancer::fastest_rtt(uint64_t now_msecs) const
+{
+    float fastest = -1;
+    for (unsigned i = 0; i < m_targets.size(); ++i) {
+        const auto& t = m_targets[i];
+        if (t.smoothed_rtt > 0 && is_healthy(i, now_msecs) && (fastest < 0 || t.smoothed_rtt < fastest))
+            fastest = t.smoothed_rtt;
+    }
+    return fastest;
+}
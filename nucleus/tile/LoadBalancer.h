@@ -0,0 +1,67 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace nucleus::tile {
+
+/// Picks a load balancing target for a tile. Tiles stick to the target given by their hash (so that http caches stay warm),
+/// as long as that target is healthy. Targets with many errors or much slower round trips than the others are ejected for a while,
+/// their tiles are spread over the healthy targets by weighted rendezvous hashing (weighted by speed and error rate).
+/// After the ejection, a target gets its tiles back and is ejected again, if it is still unhealthy. Pure logic, time is passed in.
+class LoadBalancer {
+public:
+    struct Settings {
+        float max_error_rate = 0.3f;
+        float max_rtt_ratio = 4.0f; // compared to the fastest healthy target
+        unsigned min_samples = 8; // before a target can be ejected for being slow
+        unsigned ejection_msecs = 10'000;
+    };
+    struct TargetHealth {
+        float smoothed_rtt = -1; // msecs, negative until the first successful request
+        float error_rate = 0;
+        unsigned n_samples = 0;
+        uint64_t ejected_until = 0;
+    };
+
+    explicit LoadBalancer(size_t n_targets);
+    LoadBalancer(size_t n_targets, const Settings& settings);
+
+    /// the target given by the hash, or a healthy replacement. exclude is avoided if there is any other target (e.g., for retries).
+    [[nodiscard]] unsigned select(uint32_t hash, uint64_t now_msecs, std::optional<unsigned> exclude = {}) const;
+    /// failed should be set for network errors and timeouts, not for missing tiles.
+    void report(unsigned target, unsigned rtt_msecs, bool failed, uint64_t now_msecs);
+
+    [[nodiscard]] size_t n_targets() const;
+    [[nodiscard]] bool is_healthy(unsigned target, uint64_t now_msecs) const;
+    [[nodiscard]] const TargetHealth& health(unsigned target) const;
+
+private:
+    [[nodiscard]] unsigned affine_target(uint32_t hash) const;
+    [[nodiscard]] float weight(unsigned target, uint64_t now_msecs) const;
+    [[nodiscard]] float fastest_rtt(uint64_t now_msecs) const;
+
+    Settings m;
+    std::vector<TargetHealth> m_targets;
+};
+
+} // namespace nucleus::tile
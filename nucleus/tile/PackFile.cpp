@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "PackFile.h"
+
+#include <cassert>
+
+using namespace nucleus::tile;
+
+PackFile::~PackFile() { close(); }
+
+tl::expected<void, QString> PackFile::open(const std::filesystem::path& path, bool truncate)
+{
+    close();
+    m_file.setFileName(QString::fromStdString(path.string()));
+    QIODeviceBase::OpenMode mode = QIODeviceBase::ReadWrite;
+    if (truncate)
+        mode |= QIODeviceBase::Truncate;
+    if (!m_file.open(mode))
+        return tl::unexpected(QString("Couldn't open pack file '%1': %2").arg(m_file.fileName(), m_file.errorString()));
+
+    m_path = path;
+    m_size = uint64_t(m_file.size());
+    const auto r = map();
+    if (!r.has_value())
+        close();
+    return r;
+}
+
+void PackFile::close()
+{
+    unmap();
+    if (m_file.isOpen())
+        m_file.close();
+    m_path.clear();
+    m_size = 0;
+}
+
+bool PackFile::is_open() const { return m_file.isOpen(); }
+
+const std::filesystem::path& PackFile::path() const { return m_path; }
+
+uint64_t PackFile::size() const { return m_size; }
+
+tl::expected<PackFile::Entry, QString> PackFile::append(std::span<const char> bytes)
+{
+    assert(is_open());
+    if (m_file.pos() != qint64(m_size) && !m_file.seek(qint64(m_size)))
+        return tl::unexpected(QString("Couldn't seek to the end of pack file '%1'!").arg(m_file.fileName()));
+
+    const auto written = m_file.write(bytes.data(), qint64(bytes.size()));
+    if (written != qint64(bytes.size()))
+        return tl::unexpected(QString("Couldn't append to pack file '%1': %2").arg(m_file.fileName(), m_file.errorString()));
+
+    const auto entry = Entry { m_size, uint64_t(bytes.size()) };
+    m_size += uint64_t(bytes.size());
+    return entry;
+}
+
+tl::expected<void, QString> PackFile::flush()
+{
+    assert(is_open());
+    if (!m_file.flush())
+        return tl::unexpected(QString("Couldn't flush pack file '%1': %2").arg(m_file.fileName(), m_file.errorString()));
+    if (m_mapped_size == m_size)
+        return {};
+    unmap();
+    return map();
+}
+
+std::span<const char> PackFile::view(const Entry& entry) const
+{
+    if (entry.offset > m_mapped_size || entry.size > m_mapped_size - entry.offset)
+        return {};
+    const char* base = m_mapped ? reinterpret_cast<const char*>(m_mapped) : m_fallback.constData();
+    return { base + entry.offset, size_t(entry.size) };
+}
+
+tl::expected<void, QString> PackFile::map()
+{
+    assert(m_mapped == nullptr && m_fallback.isEmpty());
+    if (m_size == 0)
+        return {};
+
+    m_mapped = m_file.map(0, qint64(m_size));
+    if (!m_mapped) {
+        if (!m_file.seek(0))
+            return tl::unexpected(QString("Couldn't read pack file '%1'!").arg(m_file.fileName()));
+        m_fallback = m_file.read(qint64(m_size));
+        if (uint64_t(m_fallback.size()) != m_size) {
+            m_fallback.clear();
+            return tl::unexpected(QString("Couldn't read pack file '%1': %2").arg(m_file.fileName(), m_file.errorString()));
+        }
+    }
+    m_mapped_size = m_size;
+    return {};
+}
+
+void PackFile::unmap()
+{
+    if (m_mapped)
+        m_file.unmap(m_mapped);
+    m_mapped = nullptr;
+    m_fallback.clear();
+    m_mapped_size = 0;
+}
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <tl/expected.hpp>
+
+namespace nucleus::tile {
+
+/// Append only file of binary blobs. The file is memory mapped on open, blobs are addressed by their offset and size.
+/// Falls back to reading the whole file, if mapping is not available (e.g., on the web). view() can be called concurrently
+/// with append(), everything else needs external synchronisation.
+class PackFile {
+public:
+    struct Entry {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    PackFile() = default;
+    ~PackFile();
+    PackFile(const PackFile&) = delete;
+    PackFile& operator=(const PackFile&) = delete;
+
+    /// creates the file if it doesn't exist. truncate discards existing content.
+    [[nodiscard]] tl::expected<void, QString> open(const std::filesystem::path& path, bool truncate = false);
+    void close();
+    [[nodiscard]] bool is_open() const;
+    [[nodiscard]] const std::filesystem::path& path() const;
+    [[nodiscard]] uint64_t size() const;
+
+    [[nodiscard]] tl::expected<Entry, QString> append(std::span<const char> bytes);
+    /// writes appended blobs through to the file and updates the mapping. must be called before viewing appended entries.
+    [[nodiscard]] tl::expected<void, QString> flush();
+    /// returns an empty span if the entry is not (yet) mapped. the span is invalidated by flush() and close().
+    [[nodiscard]] std::span<const char> view(const Entry& entry) const;
+
+private:
+    [[nodiscard]] tl::expected<void, QString> map();
+    void unmap();
+
+    std::filesystem::path m_path;
+    QFile m_file;
+    uchar* m_mapped = nullptr;
+    QByteArray m_fallback;
+    uint64_t m_mapped_size = 0;
+    uint64_t m_size = 0;
+};
+
+} // namespace nucleus::tile
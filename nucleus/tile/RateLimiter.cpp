@@ -53,6 +53,8 @@ size_t RateLimiter::queue_size() const
 
 void RateLimiter::request_quad(const tile::Id& id)
 {
+    if (!m_queued.insert(id).second)
+        return; // coalesced with the queued request
     m_request_queue.push_back(id);
     process_request_queue();
 }
@@ -60,16 +62,15 @@ void RateLimiter::request_quad(const tile::Id& id)
 void RateLimiter::process_request_queue()
 {
     const auto current_msecs = utils::time_since_epoch();
-    std::erase_if(m_in_flight, [&current_msecs, this](const auto& x) { return x < current_msecs - m_rate_period_msecs; });
-    unsigned requested_now = 0;
-    for (const auto& id : m_request_queue) {
-        if (m_in_flight.size() >= m_rate)
-            break;
+    while (!m_in_flight.empty() && m_in_flight.front() < current_msecs - m_rate_period_msecs)
+        m_in_flight.pop_front();
+    while (!m_request_queue.empty() && m_in_flight.size() < m_rate) {
+        const auto id = m_request_queue.front();
+        m_request_queue.pop_front();
+        m_queued.erase(id);
         m_in_flight.push_back(current_msecs);
-        ++requested_now;
         emit quad_requested(id);
     }
-    m_request_queue.erase(m_request_queue.cbegin(), m_request_queue.cbegin() + requested_now);
 
     if (!m_request_queue.empty()) {
         m_update_timer->start(int(1 + m_rate_period_msecs / 10));
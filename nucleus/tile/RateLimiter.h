@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <deque>
 #include <unordered_set>
 
 #include <QObject>
@@ -33,8 +34,9 @@ class RateLimiter : public QObject
     Q_OBJECT
     unsigned m_rate = 100;
     unsigned m_rate_period_msecs = 1000 * 1;
-    std::vector<tile::Id> m_request_queue;
-    std::vector<uint64_t> m_in_flight;
+    std::deque<tile::Id> m_request_queue;
+    std::unordered_set<tile::Id, tile::Id::Hasher> m_queued;
+    std::deque<uint64_t> m_in_flight; // request times, oldest first
     std::unique_ptr<QTimer> m_update_timer;
 
 public:
@@ -24,11 +24,15 @@
 #include <QDebug>
 #include <QNetworkInformation>
 #include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 #include <QVariantMap>
 #include <nucleus/DataQuerier.h>
 #include <nucleus/tile/utils.h>
 #include <radix/quad_tree.h>
+#include <algorithm>
+#include <chrono>
 #include <unordered_set>
 #include <utility>
 
@@ -48,10 +52,13 @@ Scheduler::Scheduler(const Settings& settings)
 
     m_persist_timer = std::make_unique<QTimer>(this);
     m_persist_timer->setSingleShot(true);
-    connect(m_persist_timer.get(), &QTimer::timeout, this, &Scheduler::persist_tiles);
+    connect(m_persist_timer.get(), &QTimer::timeout, this, &Scheduler::persist_tiles_in_background);
+
+    m_persist_pool = std::make_unique<QThreadPool>();
+    m_persist_pool->setMaxThreadCount(1);
 }
 
-Scheduler::~Scheduler() = default;
+Scheduler::~Scheduler() { m_persist_pool->waitForDone(); }
 
 void Scheduler::update_camera(const camera::Definition& camera)
 {
@@ -156,9 +163,45 @@ void Scheduler::update_gpu_quads()
         return false;
     });
 
+    if (m.gpu_emit_interval > 0) {
+        emit_progressively(std::move(gpu_candidates), { superfluous_ids.cbegin(), superfluous_ids.cend() });
+        return;
+    }
     transform_and_emit(gpu_candidates, { superfluous_ids.cbegin(), superfluous_ids.cend() });
 }
 
+void Scheduler::emit_progressively(std::vector<DataQuad> new_quads, const std::vector<tile::Id>& deleted_quads)
+{
+    // nearest quads first, they are the most likely to be visible and large on screen. finer quads first on ties (camera inside the box).
+    const auto camera_position = m_current_camera.position();
+    std::vector<std::tuple<double, int, size_t>> order;
+    order.reserve(new_quads.size());
+    for (size_t i = 0; i < new_quads.size(); ++i) {
+        const auto aabb = m_aabb_decorator->aabb(new_quads[i].id);
+        order.emplace_back(glm::distance(glm::clamp(camera_position, aabb.min, aabb.max), camera_position), -int(new_quads[i].id.zoom_level), i);
+    }
+    std::ranges::sort(order);
+
+    std::vector<DataQuad> sorted_quads;
+    sorted_quads.reserve(new_quads.size());
+    for (const auto& [distance, zoom, i] : order)
+        sorted_quads.push_back(std::move(new_quads[i]));
+
+    // batch sizes adapt to the measured cost per quad, but stay large enough for parallel decoding.
+    // deleted quads go with the first batch, so that their gpu slots are free for the new ones.
+    const auto min_batch_size = size_t(std::max(QThread::idealThreadCount(), 1));
+    auto batch_size = min_batch_size;
+    size_t begin = 0;
+    do {
+        const auto end = std::min(begin + batch_size, sorted_quads.size());
+        const auto start = std::chrono::steady_clock::now();
+        transform_and_emit({ sorted_quads.begin() + begin, sorted_quads.begin() + end }, begin == 0 ? deleted_quads : std::vector<tile::Id> {});
+        const auto ms_per_quad = std::max(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), 0.001) / double(std::max(end - begin, size_t(1)));
+        batch_size = std::max(min_batch_size, size_t(double(m.gpu_emit_interval) / ms_per_quad));
+        begin = end;
+    } while (begin < sorted_quads.size());
+}
+
 void Scheduler::send_quad_requests()
 {
     if (!m_network_requests_enabled)
@@ -174,17 +217,20 @@ void Scheduler::send_quad_requests()
 
 void Scheduler::purge_ram_cache()
 {
-    if (m_ram_cache.n_cached_objects() <= unsigned(float(m.ram_quad_limit) * 1.05f)) {
+    const auto n_bytes = m_ram_cache.n_cached_bytes();
+    const auto bytes_within_limit = n_bytes <= m.ram_byte_limit || n_bytes - m.ram_byte_limit <= m.ram_byte_limit / 20;
+    if (m_ram_cache.n_cached_objects() <= unsigned(float(m.ram_quad_limit) * 1.05f) && bytes_within_limit) {
         return;
     }
 
     const auto should_refine = tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level);
     m_ram_cache.visit([&should_refine](const DataQuad& quad) { return should_refine(quad.id); });
-    m_ram_cache.purge(m.ram_quad_limit);
+    m_ram_cache.purge({ m.ram_quad_limit, m.ram_byte_limit, m.ram_eviction_policy });
 
     QVariantMap stats;
     stats["n_quads_ram"] = m_ram_cache.n_cached_objects();
     stats["n_quads_ram_max"] = m.ram_quad_limit;
+    stats["n_bytes_ram"] = quint64(m_ram_cache.n_cached_bytes());
     emit stats_ready(m_name, stats);
 }
 
@@ -194,18 +240,41 @@ tl::expected<void, QString> Scheduler::persist_tiles()
         return tl::unexpected(QString("Not persisitng tiles as the scheduler is not named, and this would cause name conflicts in the file system."
                                       "Name your scheduler, e.g., by using the scheduler director."));
     }
+    m_persist_pool->waitForDone();
+    return write_disk_cache(disk_cache_path());
+}
+
+void Scheduler::persist_tiles_in_background()
+{
+    if (m_name == "unnamed" || m_name.isEmpty())
+        return;
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    write_disk_cache(disk_cache_path());
+#else
+    if (m_persist_pool->activeThreadCount() > 0) {
+        // tiles received in the meanwhile stay dirty and are written by the next run
+        schedule_persist();
+        return;
+    }
+    m_persist_pool->start([this, path = disk_cache_path()]() { write_disk_cache(path); });
+#endif
+}
+
+tl::expected<void, QString> Scheduler::write_disk_cache(const std::filesystem::path& path)
+{
+    // may run on the writer thread, touch only the (thread safe) ram cache
     const auto start = std::chrono::steady_clock::now();
-    const auto r = m_ram_cache.write_to_disk(disk_cache_path());
+    const auto r = m_ram_cache.write_to_disk(path);
     const auto diff = std::chrono::steady_clock::now() - start;
 
     if (diff > std::chrono::milliseconds(50))
-        qDebug() << QString("Scheduler::persist_tiles took %1ms for %2 quads.")
+        qDebug() << QString("Scheduler::write_disk_cache took %1ms for %2 quads.")
                         .arg(std::chrono::duration_cast<std::chrono::milliseconds>(diff).count())
                         .arg(m_ram_cache.n_cached_objects());
 
     if (!r.has_value()) {
-        qDebug() << QString("Writing tiles to disk into %1 failed: %2. Removing all files.").arg(QString::fromStdString(disk_cache_path().string())).arg(r.error());
-        std::filesystem::remove_all(disk_cache_path());
+        qDebug() << QString("Writing tiles to disk into %1 failed: %2. Removing all files.").arg(QString::fromStdString(path.string())).arg(r.error());
+        std::filesystem::remove_all(path);
     }
     return r;
 }
@@ -262,7 +331,7 @@ tl::expected<void, QString> Scheduler::read_disk_cache()
         qDebug() << error;
         return tl::unexpected(error);
     }
-    const auto r = m_ram_cache.read_from_disk(disk_cache_path());
+    const auto r = m_ram_cache.read_from_disk(disk_cache_path(), m.lazy_disk_cache ? DiskReadMode::Lazy : DiskReadMode::Eager);
     if (r.has_value()) {
         QVariantMap stats;
         stats["n_quads_ram"] = m_ram_cache.n_cached_objects();
@@ -298,6 +367,16 @@ std::vector<Id> Scheduler::missing_quads_for_current_camera() const
     std::erase_if(tiles, [this, current_time](const tile::Id& id) {
         return m_ram_cache.contains(id) && m_ram_cache.peak_at(id).network_info().timestamp + m.retirement_age_for_tile_cache > current_time;
     });
+
+    // highest screen space error first. the limiters keep the order, so quads covering much of the screen are fetched first (coarse to fine).
+    std::vector<std::pair<float, tile::Id>> prioritised;
+    prioritised.reserve(tiles.size());
+    for (const auto& id : tiles)
+        prioritised.emplace_back(tile::utils::screen_space_error(m_current_camera, m_aabb_decorator->aabb(id), m.tile_resolution), id);
+    // ties (e.g., infinite error if the camera is inside the bounds) are broken coarse first.
+    std::ranges::stable_sort(prioritised, [](const auto& a, const auto& b) { return a.first > b.first || (a.first == b.first && a.second.zoom_level < b.second.zoom_level); });
+    for (size_t i = 0; i < tiles.size(); ++i)
+        tiles[i] = prioritised[i].second;
     return tiles;
 }
 
@@ -343,8 +422,14 @@ void Scheduler::set_purge_timeout(unsigned int new_purge_timeout)
 
 void Scheduler::set_ram_quad_limit(unsigned int new_ram_quad_limit) { m.ram_quad_limit = new_ram_quad_limit; }
 
+void Scheduler::set_ram_byte_limit(uint64_t new_ram_byte_limit) { m.ram_byte_limit = new_ram_byte_limit; }
+
+void Scheduler::set_ram_eviction_policy(EvictionPolicy new_ram_eviction_policy) { m.ram_eviction_policy = new_ram_eviction_policy; }
+
 void Scheduler::set_gpu_quad_limit(unsigned int new_gpu_quad_limit) { m.gpu_quad_limit = new_gpu_quad_limit; }
 
+void Scheduler::set_gpu_emit_interval(unsigned int new_gpu_emit_interval) { m.gpu_emit_interval = new_gpu_emit_interval; }
+
 void Scheduler::set_aabb_decorator(const utils::AabbDecoratorPtr& new_aabb_decorator)
 {
     m_aabb_decorator = new_aabb_decorator;
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <limits>
 #include <memory>
 
 #include <QNetworkInformation>
@@ -28,6 +29,7 @@
 #include "radix/tile.h"
 #include "types.h"
 
+class QThreadPool;
 class QTimer;
 
 namespace nucleus {
@@ -56,6 +58,11 @@ public:
         unsigned update_timeout = 100;
         unsigned purge_timeout = 1000;
         unsigned persist_timeout = 10000;
+        bool lazy_disk_cache = true; // read tiles from the disk cache only when they are needed
+        uint64_t ram_byte_limit = std::numeric_limits<uint64_t>::max(); // applies in addition to ram_quad_limit
+        EvictionPolicy ram_eviction_policy = EvictionPolicy::Lru;
+        uint64_t decoded_cache_byte_limit = 32u * 1024u * 1024u; // decoded gpu payloads kept for quads moving back onto the gpu
+        unsigned gpu_emit_interval = 0; // ms. if > 0, new gpu quads are emitted nearest first, in batches taking roughly this long
     };
 
     explicit Scheduler(const Settings& settings);
@@ -70,8 +77,14 @@ public:
 
     void set_gpu_quad_limit(unsigned int new_gpu_quad_limit);
 
+    void set_gpu_emit_interval(unsigned int new_gpu_emit_interval);
+
     void set_ram_quad_limit(unsigned int new_ram_quad_limit);
 
+    void set_ram_byte_limit(uint64_t new_ram_byte_limit);
+
+    void set_ram_eviction_policy(EvictionPolicy new_ram_eviction_policy);
+
     void set_purge_timeout(unsigned int new_purge_timeout);
 
     const Cache<DataQuad>& ram_cache() const;
@@ -118,7 +131,9 @@ protected:
     void schedule_update();
     void schedule_purge();
     void schedule_persist();
+    void persist_tiles_in_background();
     std::vector<tile::Id> quads_for_current_camera_position() const;
+    void emit_progressively(std::vector<DataQuad> new_quads, const std::vector<tile::Id>& deleted_quads);
     virtual bool is_ready_to_ship(const DataQuad&) const { return true; }
     virtual void transform_and_emit(const std::vector<DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads) = 0;
 
@@ -136,6 +151,9 @@ private:
     utils::AabbDecoratorPtr m_aabb_decorator;
     Cache<DataQuad> m_ram_cache;
     Cache<GpuCacheInfo> m_gpu_cached;
+    std::unique_ptr<QThreadPool> m_persist_pool; // single writer thread, must be destroyed before the caches
+
+    tl::expected<void, QString> write_disk_cache(const std::filesystem::path& path);
 
 };
 }
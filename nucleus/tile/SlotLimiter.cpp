@@ -41,29 +41,37 @@ unsigned SlotLimiter::slots_taken() const
     return unsigned(m_in_flight.size());
 }
 
+size_t SlotLimiter::queue_size() const
+{
+    return m_request_queue.size();
+}
+
 void SlotLimiter::request_quads(const std::vector<tile::Id>& ids)
 {
     m_request_queue.clear();
+    m_requested.clear();
     for (const tile::Id& id : ids) {
-        if (m_in_flight.contains(id))
+        if (m_in_flight.contains(id) || !m_requested.insert(id).second)
             continue;
-        if (m_in_flight.size() >= m_limit) {
-            m_request_queue.push_back(id);
-        } else {
-            m_in_flight.insert(id);
-            emit quad_requested(id);
-        }
+        m_request_queue.push_back(id);
     }
+    dispatch_queued();
 }
 
 void SlotLimiter::deliver_quad(const DataQuad& tile)
 {
     m_in_flight.erase(tile.id);
     emit quad_delivered(tile);
-    if (m_request_queue.empty())
-        return;
+    dispatch_queued();
+}
 
-    m_in_flight.insert(m_request_queue.front());
-    emit quad_requested(m_request_queue.front());
-    m_request_queue.erase(m_request_queue.cbegin());
+void SlotLimiter::dispatch_queued()
+{
+    while (!m_request_queue.empty() && m_in_flight.size() < m_limit) {
+        const auto id = m_request_queue.front();
+        m_request_queue.pop_front();
+        if (!m_in_flight.insert(id).second)
+            continue;
+        emit quad_requested(id);
+    }
 }
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <deque>
 #include <unordered_set>
 #include <QObject>
 #include "types.h"
@@ -29,7 +30,8 @@ class SlotLimiter : public QObject {
 
     unsigned m_limit = 16;
     std::unordered_set<tile::Id, tile::Id::Hasher> m_in_flight;
-    std::vector<tile::Id> m_request_queue;
+    std::deque<tile::Id> m_request_queue; // in order of priority
+    std::unordered_set<tile::Id, tile::Id::Hasher> m_requested; // ids of the last request, for coalescing duplicates
 
 public:
     explicit SlotLimiter(QObject* parent = nullptr);
@@ -37,11 +39,16 @@ public:
     void set_limit(unsigned int new_limit);
     [[nodiscard]] unsigned int limit() const;
     unsigned int slots_taken() const;
+    [[nodiscard]] size_t queue_size() const;
 
 public slots:
+    /// replaces the queue, i.e., queued quads that are not requested anymore are cancelled. duplicates and quads in flight are requested only once.
     void request_quads(const std::vector<tile::Id>& id);
     void deliver_quad(const DataQuad& tile);
 
+private:
+    void dispatch_queued();
+
 signals:
     void quad_requested(const tile::Id& tile_id);
     void quad_delivered(const DataQuad& id);
@@ -21,52 +21,67 @@
 #include "conversion.h"
 #include <QDebug>
 #include <extern/libktx/lib/include/ktx.h>
+#include <nucleus/utils/thread.h>
 
 
 namespace nucleus::tile {
 
 Texture3DScheduler::Texture3DScheduler(const Scheduler::Settings& settings)
     : nucleus::tile::Scheduler(settings)
+    , m_default_texture(std::make_shared<const nucleus::utils::MipmappedColourTexture3D>())
 {
 }
 
 Texture3DScheduler::~Texture3DScheduler() = default;
 
+void Texture3DScheduler::set_default_texture(std::shared_ptr<const nucleus::utils::MipmappedColourTexture3D> texture)
+{
+    assert(texture);
+    m_default_texture = std::move(texture);
+}
+
 void Texture3DScheduler::transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads)
 {
     // Stitching 2x2 3d tiles is possible, but it doesn't really make sense (to me).
-    std::vector<GpuTexture3DTile> new_gpu_tiles;
-    new_gpu_tiles.reserve(new_quads.size() * 4);
-
+    std::vector<const tile::Data*> tiles;
+    tiles.reserve(new_quads.size() * 4);
     for (const auto& quad : new_quads) {
         for (size_t i = 0; i < 4; i++) {
-            const auto& tile = quad.tiles[i];
-
-            if (tile.data->size() == 0)
-                continue;
-
-            // NOTE: This implementation is quite specific to the cloud texture loading. Not intended for general purpose use.
-
-            GpuTexture3DTile gpu_tile;
-            gpu_tile.id = tile.id;
-            auto&& texture = std::make_shared<nucleus::utils::MipmappedColourTexture3D>();
-            gpu_tile.texture = texture;
-
-            ktxTexture* ktx = nullptr;
-            ktxTexture_CreateFromMemory(reinterpret_cast<const ktx_uint8_t*>(tile.data.get()->data()), tile.data->size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktx);
-
-            texture->reserve(ktx->numLevels);
-            ktxTexture_IterateLevelFaces(ktx, [](int /*miplevel*/, int /*face*/, int width, int height, int depth, ktx_uint64_t faceLodSize, void *pixels, void *userdata) {
-                auto* result = static_cast<std::vector<nucleus::utils::ColourTexture3D>*>(userdata);
-                std::span byte_span{static_cast<uint8_t*>(pixels), static_cast<size_t>(faceLodSize)};
-                result->emplace_back(byte_span, width, height, depth, nucleus::utils::ColourTexture3D::Format::BC4_UNORM);
-                return KTX_SUCCESS;
-            }, texture.get());
-            
-            new_gpu_tiles.push_back(gpu_tile);
+            if (quad.tiles[i].data->size())
+                tiles.push_back(&quad.tiles[i]);
         }
     }
 
+    std::vector<GpuTexture3DTile> new_gpu_tiles(tiles.size());
+    nucleus::utils::thread::parallel_for(tiles.size(), [&](size_t i) {
+        const auto& tile = *tiles[i];
+
+        // NOTE: This implementation is quite specific to the cloud texture loading. Not intended for general purpose use.
+
+        GpuTexture3DTile& gpu_tile = new_gpu_tiles[i];
+        gpu_tile.id = tile.id;
+        gpu_tile.texture = m_default_texture;
+
+        ktxTexture* ktx = nullptr;
+        const auto created = ktxTexture_CreateFromMemory(reinterpret_cast<const ktx_uint8_t*>(tile.data.get()->data()), tile.data->size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktx);
+        if (created != KTX_SUCCESS || !ktx) {
+            qWarning() << QString("Couldn't decode the ktx texture of tile %1/%2/%3: %4").arg(tile.id.zoom_level).arg(tile.id.coords.x).arg(tile.id.coords.y).arg(ktxErrorString(created));
+            return;
+        }
+
+        auto texture = std::make_shared<nucleus::utils::MipmappedColourTexture3D>();
+        texture->reserve(ktx->numLevels);
+        const auto iterated = ktxTexture_IterateLevelFaces(ktx, [](int /*miplevel*/, int /*face*/, int width, int height, int depth, ktx_uint64_t faceLodSize, void *pixels, void *userdata) {
+            auto* result = static_cast<std::vector<nucleus::utils::ColourTexture3D>*>(userdata);
+            std::span byte_span{static_cast<uint8_t*>(pixels), static_cast<size_t>(faceLodSize)};
+            result->emplace_back(byte_span, width, height, depth, nucleus::utils::ColourTexture3D::Format::BC4_UNORM);
+            return KTX_SUCCESS;
+        }, texture.get());
+        ktxTexture_Destroy(ktx); // levels were copied
+        if (iterated == KTX_SUCCESS)
+            gpu_tile.texture = std::move(texture);
+    });
+
     std::vector<tile::Id> deleted_tiles;
     deleted_tiles.reserve(deleted_quads.size() * 4);
     for (const auto & deleted_quad : deleted_quads) {
@@ -31,11 +31,17 @@ public:
     Texture3DScheduler(const Scheduler::Settings& settings);
     ~Texture3DScheduler() override;
 
+    /// used for tiles that can't be decoded. empty by default, i.e., nothing is uploaded for them.
+    void set_default_texture(std::shared_ptr<const nucleus::utils::MipmappedColourTexture3D> texture);
+
 signals:
     void gpu_tiles_updated(const std::vector<tile::Id>& deleted_tiles, const std::vector<GpuTexture3DTile>& new_tiles);
 
 protected:
     void transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads) override;
+
+private:
+    std::shared_ptr<const nucleus::utils::MipmappedColourTexture3D> m_default_texture;
 };
 
 } // namespace nucleus::tile
@@ -20,12 +20,14 @@
 #include "conversion.h"
 #include <QDebug>
 #include <nucleus/utils/image_loader.h>
+#include <nucleus/utils/thread.h>
 
 namespace nucleus::tile {
 
 TextureScheduler::TextureScheduler(const Scheduler::Settings& settings)
     : nucleus::tile::Scheduler(settings)
     , m_default_raster(glm::uvec2(settings.tile_resolution), { 255, 255, 255, 255 })
+    , m_decoded_cache(settings.decoded_cache_byte_limit)
 {
 }
 
@@ -34,44 +36,72 @@ TextureScheduler::~TextureScheduler() = default;
 void TextureScheduler::transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads)
 {
     std::vector<GpuTextureTile> new_gpu_tiles;
-    new_gpu_tiles.reserve(new_gpu_tiles.size() * 4);
+    new_gpu_tiles.reserve(new_quads.size());
+    std::vector<size_t> to_decode; // indices into new_quads and new_gpu_tiles
 
     for (const auto& quad : new_quads) {
         GpuTextureTile gpu_tile;
         gpu_tile.id = quad.id;
-        auto ortho_raster = to_raster(quad, m_default_raster);
-        gpu_tile.texture = std::make_shared<nucleus::utils::MipmappedColourTexture>(generate_mipmapped_colour_texture(ortho_raster, m_compression_algorithm));
+        gpu_tile.texture = m_decoded_cache.get(quad.id, quad.network_info().timestamp);
+        if (!gpu_tile.texture)
+            to_decode.push_back(new_gpu_tiles.size());
         new_gpu_tiles.push_back(gpu_tile);
     }
 
+    // decoding, stitching and compression run in parallel, the decoded cache is only touched from this thread.
+    nucleus::utils::thread::parallel_for(to_decode.size(), [&](size_t i) {
+        const auto index = to_decode[i];
+        const auto ortho_raster = to_raster(new_quads[index], m_default_raster);
+        new_gpu_tiles[index].texture = std::make_shared<nucleus::utils::MipmappedColourTexture>(generate_mipmapped_colour_texture(ortho_raster, m_compression_algorithm));
+    });
+    for (const auto index : to_decode) {
+        uint64_t n_bytes = 0;
+        for (const auto& level : *new_gpu_tiles[index].texture)
+            n_bytes += level.n_bytes();
+        m_decoded_cache.put(new_quads[index].id, new_quads[index].network_info().timestamp, new_gpu_tiles[index].texture, n_bytes);
+    }
+
     // we are merging the tiles. so deleted quads become deleted tiles.
     emit gpu_tiles_updated(deleted_quads, new_gpu_tiles);
+    emit stats_ready(name(), m_decoded_cache.statistics());
 }
 
-void TextureScheduler::set_texture_compression_algorithm(nucleus::utils::ColourTexture::Format compression_algorithm) { m_compression_algorithm = compression_algorithm; }
+void TextureScheduler::set_texture_compression_algorithm(nucleus::utils::ColourTexture::Format compression_algorithm)
+{
+    if (compression_algorithm != m_compression_algorithm)
+        m_decoded_cache.clear(); // cached textures are compressed with the old algorithm
+    m_compression_algorithm = compression_algorithm;
+}
 
 Raster<glm::u8vec4> TextureScheduler::to_raster(const tile::DataQuad& quad, const Raster<glm::u8vec4>& default_raster)
 {
     assert(quad.n_tiles == 4);
 
-    std::array<Raster<glm::u8vec4>, 4> quad_rasters;
-    std::array<tile::Id, 4> quad_ids;
+    // tiles are decoded straight into their quadrant
+    const auto tile_size = default_raster.size();
+    Raster<glm::u8vec4> ortho_raster(tile_size * 2u);
     for (const auto& tile : quad.tiles) {
-        const auto quad_index = unsigned(quad_position(tile.id));
-        quad_ids[quad_index] = tile.id;
-        if (tile.data->size()) {
-            // Ortho image is available
-            const auto ortho_raster = nucleus::utils::image_loader::rgba8(*tile.data.get()).value_or(default_raster);
-            quad_rasters[quad_index] = std::move(ortho_raster);
-        } else {
-            // Ortho image is not available (use white default tile)
-            quad_rasters[quad_index] = default_raster;
+        auto offset = glm::uvec2(0, 0);
+        switch (quad_position(tile.id)) {
+        case tile::QuadPosition::TopLeft:
+            break;
+        case tile::QuadPosition::TopRight:
+            offset = { tile_size.x, 0 };
+            break;
+        case tile::QuadPosition::BottomLeft:
+            offset = { 0, tile_size.y };
+            break;
+        case tile::QuadPosition::BottomRight:
+            offset = tile_size;
+            break;
+        }
+        auto* destination = &ortho_raster.pixel(offset);
+        // Ortho image is not available or broken (use white default tile)
+        if (!tile.data->size() || !nucleus::utils::image_loader::rgba8_into(*tile.data, destination, tile_size, ortho_raster.width())) {
+            for (unsigned row = 0; row < tile_size.y; ++row)
+                std::copy_n(&default_raster.pixel({ 0, row }), tile_size.x, destination + size_t(row) * ortho_raster.width());
         }
     }
-
-    auto ortho_raster = nucleus::concatenate_horizontally(quad_rasters[unsigned(tile::QuadPosition::TopLeft)], quad_rasters[unsigned(tile::QuadPosition::TopRight)]);
-    ortho_raster.append_vertically(nucleus::concatenate_horizontally(quad_rasters[unsigned(tile::QuadPosition::BottomLeft)], quad_rasters[unsigned(tile::QuadPosition::BottomRight)]));
-
     return ortho_raster;
 }
 
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "DecodedTileCache.h"
 #include "Scheduler.h"
 #include "types.h"
 
@@ -41,6 +42,7 @@ protected:
 private:
     nucleus::utils::ColourTexture::Format m_compression_algorithm = nucleus::utils::ColourTexture::Format::Uncompressed_RGBA;
     Raster<glm::u8vec4> m_default_raster;
+    DecodedTileCache<std::shared_ptr<const nucleus::utils::MipmappedColourTexture>> m_decoded_cache;
 };
 
 } // namespace nucleus::tile
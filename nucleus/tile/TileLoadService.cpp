@@ -34,24 +34,64 @@ TileLoadService::TileLoadService(const QString& base_url, UrlPattern url_pattern
     , m_url_pattern(url_pattern)
     , m_file_ending(file_ending)
     , m_load_balancing_targets(load_balancing_targets)
+    , m_targets(std::max(load_balancing_targets.size(), size_t(1)))
+    , m_load_balancer(m_targets.size())
 {
 }
 
 TileLoadService::~TileLoadService() = default;
 
-void TileLoadService::load(const tile::Id& tile_id) const
+void TileLoadService::load(const tile::Id& tile_id) { enqueue({ tile_id }); }
+
+void TileLoadService::enqueue(const Request& request, std::optional<unsigned> exclude_target)
+{
+    const auto hash = uint32_t(qHash(tile_address(request.id)));
+    const auto target = m_load_balancer.select(hash, utils::time_since_epoch(), exclude_target);
+    m_targets[target].queue.push_back(request);
+    dispatch(target);
+}
+
+void TileLoadService::dispatch(unsigned target_index)
+{
+    auto& target = m_targets[target_index];
+    while (!target.queue.empty() && target.concurrency.can_start()) {
+        const auto request = target.queue.front();
+        target.queue.pop_front();
+        send_request(request, target_index);
+    }
+}
+
+void TileLoadService::send_request(const Request& tile_request, unsigned target_index)
 {
-    QNetworkRequest request(QUrl(build_tile_url(tile_id)));
+    const auto tile_id = tile_request.id;
+    QNetworkRequest request(QUrl(tile_url(tile_address(tile_id), target_index)));
     request.setTransferTimeout(int(m_transfer_timeout));
     request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
     request.setAttribute(QNetworkRequest::UseCredentialsAttribute, false);
 #endif
 
+    const auto ticket = m_targets[target_index].concurrency.start();
+    const auto start_time = utils::time_since_epoch();
     QNetworkReply* reply = m_network_manager->get(request);
-    connect(reply, &QNetworkReply::finished, [tile_id, reply, this]() {
+    connect(reply, &QNetworkReply::finished, this, [tile_request, tile_id, reply, target_index, ticket, start_time, this]() {
         const auto error = reply->error();
         const auto timestamp = utils::time_since_epoch();
+        const auto failed = error != QNetworkReply::NoError && error != QNetworkReply::ContentNotFoundError;
+        // only complete transfers from the host measure the link. cache hits and missing tiles are (almost) free.
+        const auto measured = error == QNetworkReply::NoError && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200
+            && !reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+        const auto rtt = unsigned(timestamp - start_time);
+        m_targets[target_index].concurrency.finish(ticket, measured ? std::optional(rtt) : std::nullopt, failed);
+        if (measured || failed)
+            m_load_balancer.report(target_index, rtt, failed, timestamp);
+        if (failed && tile_request.attempt == 0 && m_targets.size() > 1) {
+            // fail over to another target
+            reply->deleteLater();
+            enqueue({ tile_id, tile_request.attempt + 1 }, target_index);
+            dispatch(target_index);
+            return;
+        }
         if (error == QNetworkReply::NoError) {
             auto tile = std::make_shared<QByteArray>(reply->readAll());
             emit load_finished({tile_id, {NetworkInfo::Status::Good, timestamp}, tile});
@@ -64,10 +104,17 @@ void TileLoadService::load(const tile::Id& tile_id) const
             emit load_finished({tile_id, {NetworkInfo::Status::NetworkError, timestamp}, tile});
         }
         reply->deleteLater();
+        dispatch(target_index);
     });
 }
 
 QString TileLoadService::build_tile_url(tile::Id tile_id) const
+{
+    const auto address = tile_address(tile_id);
+    return tile_url(address, m_load_balancer.select(uint32_t(qHash(address)), utils::time_since_epoch()));
+}
+
+QString TileLoadService::tile_address(tile::Id tile_id) const
 {
     switch (m_url_pattern) {
     case UrlPattern::ZXY:
@@ -80,23 +127,21 @@ QString TileLoadService::build_tile_url(tile::Id tile_id) const
         break;
     }
 
-    QString tile_address;
     switch (m_url_pattern) {
     case UrlPattern::ZXY:
     case UrlPattern::ZXY_yPointingSouth:
-        tile_address = QString("%1/%2/%3").arg(tile_id.zoom_level).arg(tile_id.coords.x).arg(tile_id.coords.y);
-        break;
+        return QString("%1/%2/%3").arg(tile_id.zoom_level).arg(tile_id.coords.x).arg(tile_id.coords.y);
     case UrlPattern::ZYX:
     case UrlPattern::ZYX_yPointingSouth:
-        tile_address = QString("%1/%3/%2").arg(tile_id.zoom_level).arg(tile_id.coords.x).arg(tile_id.coords.y);
-        break;
-    }
-    if (!m_load_balancing_targets.empty()) {
-        const unsigned hash = qHash(tile_address) % 1024;
-        const auto index = unsigned((float(hash) / 1024.1f) * float(m_load_balancing_targets.size()));
-        assert(index < m_load_balancing_targets.size());
-        return m_base_url.arg(m_load_balancing_targets[index]) + tile_address + m_file_ending;
+        return QString("%1/%3/%2").arg(tile_id.zoom_level).arg(tile_id.coords.x).arg(tile_id.coords.y);
     }
+    return {};
+}
+
+QString TileLoadService::tile_url(const QString& tile_address, unsigned target_index) const
+{
+    if (!m_load_balancing_targets.empty())
+        return m_base_url.arg(m_load_balancing_targets[target_index]) + tile_address + m_file_ending;
     return m_base_url + tile_address + m_file_ending;
 }
 
@@ -112,3 +157,13 @@ void TileLoadService::set_transfer_timeout(unsigned int new_transfer_timeout)
 }
 
 void TileLoadService::set_base_url(const QString& base_url) { m_base_url = base_url; }
+
+size_t TileLoadService::n_targets() const { return m_targets.size(); }
+
+const ConcurrencyController& TileLoadService::concurrency(size_t target_index) const
+{
+    assert(target_index < m_targets.size());
+    return m_targets[target_index].concurrency;
+}
+
+const LoadBalancer& TileLoadService::load_balancer() const { return m_load_balancer; }
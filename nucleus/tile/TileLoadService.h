@@ -18,8 +18,11 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
 #include <QObject>
+#include "ConcurrencyController.h"
+#include "LoadBalancer.h"
 #include "constants.h"
 #include "types.h"
 
@@ -47,18 +50,41 @@ public:
 
     void set_base_url(const QString& base_url);
 
+    /// number of hosts, i.e., load balancing targets (or 1 without load balancing)
+    [[nodiscard]] size_t n_targets() const;
+    [[nodiscard]] const ConcurrencyController& concurrency(size_t target_index = 0) const;
+    [[nodiscard]] const LoadBalancer& load_balancer() const;
+
 public slots:
-    void load(const tile::Id& tile_id) const;
+    /// requests are queued per host, and sent as permitted by the host's ConcurrencyController
+    void load(const tile::Id& tile_id);
 
 signals:
     void load_finished(Data tile) const;
 
 private:
+    struct Request {
+        tile::Id id;
+        unsigned attempt = 0; // failed requests are retried once on another target
+    };
+    struct Target {
+        ConcurrencyController concurrency;
+        std::deque<Request> queue;
+    };
+
+    [[nodiscard]] QString tile_address(tile::Id tile_id) const;
+    [[nodiscard]] QString tile_url(const QString& tile_address, unsigned target_index) const;
+    void enqueue(const Request& request, std::optional<unsigned> exclude_target = {});
+    void dispatch(unsigned target_index);
+    void send_request(const Request& request, unsigned target_index);
+
     unsigned m_transfer_timeout = tile::constants::default_network_timeout;
     std::shared_ptr<QNetworkAccessManager> m_network_manager;
     QString m_base_url;
     UrlPattern m_url_pattern;
     QString m_file_ending;
     LoadBalancingTargets m_load_balancing_targets;
+    std::vector<Target> m_targets;
+    LoadBalancer m_load_balancer;
 };
 }
@@ -19,44 +19,61 @@
 
 #pragma once
 
+#include "nucleus/HeightSampler.h"
 #include "nucleus/srs.h"
 #include "nucleus/tile/Cache.h"
-#include "radix/height_encoding.h"
 
-#include "nucleus/utils/image_loader.h"
+#include <limits>
+#include <span>
 
 namespace nucleus::tile::cache_queries {
 
-inline tl::expected<float, QString> query_altitude(MemoryCache* cache, const glm::dvec2& lat_long)
+/// finest available tile (up to max_zoom_level) for each of the world space points. all points are looked up in a single visit.
+inline std::vector<nucleus::tile::Data> finest_tiles(MemoryCache* cache, std::span<const glm::dvec2> world_space_points, unsigned max_zoom_level = std::numeric_limits<unsigned>::max())
 {
-    const auto world_space = srs::lat_long_to_world(lat_long);
-    nucleus::tile::Data selected_tile;
-    cache->visit([&](const nucleus::tile::DataQuad& tile) {
-        for (const auto& t : tile.tiles) {
-            if (srs::tile_bounds(t.id).contains(world_space) && t.network_info.status == NetworkInfo::Status::Good) {
-                selected_tile = t;
-                return true;
+    std::vector<nucleus::tile::Data> selected_tiles(world_space_points.size());
+    cache->visit([&](const nucleus::tile::DataQuad& quad) {
+        if (quad.id.zoom_level >= max_zoom_level)
+            return false; // the tiles of this quad are one level finer
+        bool found = false;
+        for (const auto& t : quad.tiles) {
+            if (t.network_info.status != NetworkInfo::Status::Good)
+                continue;
+            const auto bounds = srs::tile_bounds(t.id);
+            for (size_t i = 0; i < world_space_points.size(); ++i) {
+                if (bounds.contains(world_space_points[i])) {
+                    selected_tiles[i] = t; // children are visited after their parents
+                    found = true;
+                }
             }
         }
-        return false;
+        return found;
     });
-    if (!selected_tile.data)
-        return tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_long.x).arg(lat_long.y));
-    assert(selected_tile.data->size());
-
-    const auto bounds = srs::tile_bounds(selected_tile.id);
-    const auto uv = (world_space - bounds.min) / bounds.size();
-
-    if (selected_tile.data && selected_tile.data->size()) {
-        if (const auto height_tile_expected = nucleus::utils::image_loader::rgba8(*selected_tile.data)) {
-            const auto& height_tile = height_tile_expected.value();
-            const auto p = glm::uvec2(uint32_t(uv.x * height_tile.width()), uint32_t((1 - uv.y) * height_tile.height()));
-            const auto px = height_tile.pixel(p);
-            return radix::height_encoding::to_float(glm::u8vec3(px));
+    return selected_tiles;
+}
+
+/// batched altitude lookup, see HeightSampler. decoded tiles are reused across calls through the sampler's cache.
+inline std::vector<tl::expected<float, QString>> query_altitudes(const HeightSampler& sampler, std::span<const glm::dvec2> lat_longs)
+{
+    const auto samples = sampler.sample(lat_longs);
+    std::vector<tl::expected<float, QString>> altitudes;
+    altitudes.reserve(lat_longs.size());
+    for (size_t i = 0; i < lat_longs.size(); ++i) {
+        if (!samples[i]) {
+            altitudes.push_back(tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_longs[i].x).arg(lat_longs[i].y)));
+            continue;
         }
+        altitudes.push_back(samples[i]->altitude);
     }
-    assert(false);
-    return tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_long.x).arg(lat_long.y));
+    return altitudes;
 }
 
+/// every tile is decoded at most once per call, nothing is kept afterwards.
+inline std::vector<tl::expected<float, QString>> query_altitudes(MemoryCache* cache, std::span<const glm::dvec2> lat_longs)
+{
+    return query_altitudes(HeightSampler(cache, 0), lat_longs);
+}
+
+inline tl::expected<float, QString> query_altitude(MemoryCache* cache, const glm::dvec2& lat_long) { return query_altitudes(cache, std::span(&lat_long, 1)).front(); }
+
 } // namespace nucleus::tile::cache_queries
@@ -21,15 +21,12 @@
 
 #include <QByteArray>
 
+#include <nucleus/Raster.h>
 #include <nucleus/utils/ColourTexture.h>
 #include <nucleus/utils/ColourTexture3D.h>
 #include <nucleus/utils/lang.h>
 #include <radix/tile.h>
 
-namespace nucleus {
-template <typename T>
-class Raster;
-}
 namespace nucleus::tile {
 using namespace radix::tile;
 
@@ -78,6 +75,15 @@ struct DataQuad {
     unsigned n_tiles = 0;
     std::array<Data, 4> tiles = {};
     NetworkInfo network_info() const { return NetworkInfo::join(tiles[0].network_info, tiles[1].network_info, tiles[2].network_info, tiles[3].network_info); }
+    uint64_t size_in_bytes() const
+    {
+        uint64_t size = sizeof(DataQuad);
+        for (const auto& tile : tiles) {
+            if (tile.data)
+                size += uint64_t(tile.data->size());
+        }
+        return size;
+    }
     static constexpr std::array<char, 25> version_information = { "DataQuad, version 0.1" };
 };
 static_assert(NamedTile<DataQuad>);
@@ -229,9 +229,17 @@ namespace utils {
         return refine;
     }
 
-    inline auto refineFunctor(const nucleus::camera::Definition& camera, const AabbDecoratorPtr& aabb_decorator, unsigned tile_size, unsigned max_zoom_level)
+    /// projected size of a tile pixel on screen. tiles are refined if it is above the camera's error threshold.
+    inline float screen_space_error(const nucleus::camera::Definition& camera, const tile::SrsAndHeightBounds& aabb, unsigned tile_size)
     {
         constexpr auto sqrt2 = 1.414213562373095;
+        const auto distance = float(radix::geometry::distance(aabb, camera.position()));
+        const auto pixel_size = float(sqrt2 * aabb.size().x / tile_size);
+        return camera.to_screen_space(pixel_size, distance);
+    }
+
+    inline auto refineFunctor(const nucleus::camera::Definition& camera, const AabbDecoratorPtr& aabb_decorator, unsigned tile_size, unsigned max_zoom_level)
+    {
         const auto camera_frustum = camera.frustum();
         auto refine = [&camera, camera_frustum, tile_size, aabb_decorator, max_zoom_level](const tile::Id& tile) {
             if (tile.zoom_level >= max_zoom_level)
@@ -241,10 +249,7 @@ namespace utils {
             if (!tile::utils::camera_frustum_contains_tile(camera_frustum, aabb))
                 return false;
 
-            const auto distance = float(radix::geometry::distance(aabb, camera.position()));
-            const auto pixel_size = float(sqrt2 * aabb.size().x / tile_size);
-
-            return camera.to_screen_space(pixel_size, distance) >= camera.pixel_error_threshold();
+            return screen_space_error(camera, aabb, tile_size) >= camera.pixel_error_threshold();
         };
         return refine;
     }
@@ -18,6 +18,7 @@
  *****************************************************************************/
 
 #include "ColourTexture.h"
+#include "thread.h"
 
 #include <QtGlobal>
 #include <array>
@@ -29,119 +30,119 @@
 
 
 namespace {
+using Format = nucleus::utils::ColourTexture::Format;
 
-std::vector<uint8_t> to_dxt1(const nucleus::Raster<glm::u8vec4>& image)
-{
-    assert(image.width() == image.height());
-    assert(image.width() % 16 == 0);
-    assert(image.size_per_line() * image.height() == image.width() * image.height() * 4);
-    assert(image.size_in_bytes() == image.width() * image.height() * 4);
+struct alignas(16) AlignedBlock {
+    std::array<uint8_t, 16> data;
+};
+static_assert(sizeof(AlignedBlock) == 16);
 
-    struct alignas(16) AlignedBlock
-    {
-        std::array<uint8_t, 16> data;
-    };
-    static_assert(sizeof(AlignedBlock) == 16);
+// goofy requires the width to be a multiple of 16 and 16 byte aligned input. bands of 16 rows satisfy the same constraints as the whole image.
+constexpr unsigned band_height = 16;
 
-    const auto n_bytes_in = size_t(image.size_in_bytes());
-    const auto n_bytes_out = image.width() * image.height() / 2;
-    assert(n_bytes_in % sizeof(AlignedBlock) == 0);
-
-    auto aligned_in = std::vector<AlignedBlock>(n_bytes_in / sizeof(AlignedBlock));
-    auto data_ptr = reinterpret_cast<uint8_t*>(aligned_in.data());
-    std::copy(image.bytes(), image.bytes() + n_bytes_in, data_ptr);
-
-    std::vector<uint8_t> compressed(n_bytes_out);
-    const auto result = goofy::compressDXT1(compressed.data(), data_ptr, (uint32_t)image.width(), (uint32_t)image.height(), (uint32_t)image.width() * 4);
+void compress(Format format, uint8_t* out, const uint8_t* in, unsigned width, unsigned height)
+{
+    assert(reinterpret_cast<uintptr_t>(in) % alignof(AlignedBlock) == 0);
+    int result = -1;
+    if (format == Format::DXT1)
+        result = goofy::compressDXT1(out, in, width, height, width * 4);
+    else if (format == Format::ETC1)
+        result = goofy::compressETC1(out, in, width, height, width * 4);
     assert(result == 0);
     Q_UNUSED(result);
-
-    return compressed;
 }
 
-std::vector<uint8_t> to_etc1(const nucleus::Raster<glm::u8vec4>& image)
+/// both formats store 8 bytes per 4x4 block, block rows top to bottom. bands of 16 pixel rows are therefore independent and encoded in parallel.
+std::vector<uint8_t> to_block_compressed(const nucleus::Raster<glm::u8vec4>& image, Format format)
 {
     assert(image.width() == image.height());
     assert(image.width() % 16 == 0);
     assert(image.size_per_line() * image.height() == image.width() * image.height() * 4);
     assert(image.size_in_bytes() == image.width() * image.height() * 4);
 
-    struct alignas(16) AlignedBlock
-    {
-        std::array<uint8_t, 16> data;
-    };
-    static_assert(sizeof(AlignedBlock) == 16);
+    const auto width = image.width();
+    const auto n_bytes_per_band_in = size_t(width) * band_height * 4;
+    const auto n_bytes_per_band_out = size_t(width) * band_height / 2;
+    // rows are a multiple of 64 bytes long, so all bands are aligned if the first one is
+    const auto is_aligned = reinterpret_cast<uintptr_t>(image.bytes()) % alignof(AlignedBlock) == 0;
+
+    std::vector<uint8_t> compressed(size_t(width) * image.height() / 2);
+    nucleus::utils::thread::parallel_for(image.height() / band_height, [&](size_t band) {
+        const uint8_t* in = image.bytes() + band * n_bytes_per_band_in;
+        std::vector<AlignedBlock> aligned_in;
+        if (!is_aligned) {
+            aligned_in.resize(n_bytes_per_band_in / sizeof(AlignedBlock));
+            std::copy(in, in + n_bytes_per_band_in, reinterpret_cast<uint8_t*>(aligned_in.data()));
+            in = reinterpret_cast<const uint8_t*>(aligned_in.data());
+        }
+        compress(format, compressed.data() + band * n_bytes_per_band_out, in, width, band_height);
+    });
+    return compressed;
+}
 
-    const auto n_bytes_in = size_t(image.size_in_bytes());
-    const auto n_bytes_out = image.width() * image.height() / 2;
-    assert(n_bytes_in % sizeof(AlignedBlock) == 0);
+/// Levels smaller than 16 pixels are placed at block positions into a single 16x16 tile, so that the small end of a
+/// mip chain (8, 4, 2 and 1) is encoded in one go. Levels smaller than a block are padded by repeating the edge.
+class SmallLevelTile {
+public:
+    static constexpr unsigned size = 16;
+    static constexpr unsigned n_blocks = size / 4;
 
-    auto aligned_in = std::vector<AlignedBlock>(n_bytes_in / sizeof(AlignedBlock));
-    auto data_ptr = reinterpret_cast<uint8_t*>(aligned_in.data());
-    std::copy(image.bytes(), image.bytes() + n_bytes_in, data_ptr);
+    void place(const nucleus::Raster<glm::u8vec4>& image, const glm::uvec2& block)
+    {
+        const auto n = std::max(image.width(), 4u);
+        assert(image.width() == image.height() && image.width() < size);
+        assert((block.x * 4 + n) <= size && (block.y * 4 + n) <= size);
+        for (unsigned y = 0; y < n; ++y) {
+            for (unsigned x = 0; x < n; ++x)
+                m_pixels[(block.y * 4 + y) * size + block.x * 4 + x] = image.pixel({ std::min(x, image.width() - 1), std::min(y, image.height() - 1) });
+        }
+    }
 
-    std::vector<uint8_t> compressed(n_bytes_out);
-    const auto result = goofy::compressETC1(compressed.data(), data_ptr, (uint32_t)image.width(), (uint32_t)image.height(), (uint32_t)image.width() * 4);
-    assert(result == 0);
-    Q_UNUSED(result);
+    void encode(Format format) { compress(format, m_compressed.data(), reinterpret_cast<const uint8_t*>(m_pixels.data()), size, size); }
 
-    return compressed;
-}
+    [[nodiscard]] std::vector<uint8_t> blocks(unsigned image_width, const glm::uvec2& block) const
+    {
+        const auto n = std::max(image_width / 4, 1u);
+        std::vector<uint8_t> data;
+        data.reserve(n * n * 8);
+        for (unsigned y = 0; y < n; ++y) {
+            const auto* row = m_compressed.data() + ((block.y + y) * n_blocks + block.x) * 8;
+            data.insert(data.end(), row, row + n * 8);
+        }
+        return data;
+    }
+
+private:
+    alignas(16) std::array<glm::u8vec4, size * size> m_pixels = {};
+    std::array<uint8_t, n_blocks * n_blocks * 8> m_compressed = {};
+};
 
 std::vector<uint8_t> to_uncompressed_rgba(const nucleus::Raster<glm::u8vec4>& image)
 {
     size_t size_in_bytes = image.size_in_bytes();
     assert(size_in_bytes == (size_t)image.width() * image.height() * 4);
     std::vector<uint8_t> data(size_in_bytes);
-    // Note: AND Another copy... We copy the data two times (once in stb_image_loader.cpp)
+    // Note: ColourTexture owns a plain byte vector, so the pixels are copied once here
     std::copy(image.bytes(), image.bytes() + image.size_in_bytes(), data.data());
     return data;
 }
 
-std::vector<uint8_t> to_compressed(const nucleus::Raster<glm::u8vec4>& image, nucleus::utils::ColourTexture::Format algorithm)
+std::vector<uint8_t> to_compressed(const nucleus::Raster<glm::u8vec4>& image, Format algorithm)
 {
-    using Algorithm = nucleus::utils::ColourTexture::Format;
     assert(image.width() == image.height());
     assert(image.width() % 4 == 0 || image.width() == 2 || image.width() == 1);
 
     switch (algorithm) {
-    case Algorithm::Uncompressed_RGBA:
+    case Format::Uncompressed_RGBA:
         return to_uncompressed_rgba(image);
-    case nucleus::utils::ColourTexture::Format::DXT1: {
+    case Format::DXT1:
+    case Format::ETC1: {
         if (image.width() >= 16)
-            return to_dxt1(image);
-        glm::u32vec4 avg = {};
-        for (const auto& c : image.buffer()) {
-            avg += glm::u32vec4(c);
-        }
-        avg /= image.buffer_length();
-        auto v = to_dxt1(nucleus::resize(image, { 16, 16 }, glm::u8vec4(avg)));
-        if (image.width() == 8) {
-            for (auto i = 16u; i < 32; ++i)
-                v[i] = v[i + 16u];
-            v.resize(32);
-        } else if (image.width() <= 4) {
-            v.resize(8);
-        }
-        return v;
-    }
-    case nucleus::utils::ColourTexture::Format::ETC1: {
-        if (image.width() >= 16)
-            return to_etc1(image);
-        glm::u32vec4 avg = {};
-        for (const auto& c : image.buffer()) {
-            avg += glm::u32vec4(c);
-        }
-        avg /= image.buffer_length();
-        auto v = to_etc1(nucleus::resize(image, { 16, 16 }, glm::u8vec4(avg)));
-        if (image.width() == 8) {
-            for (auto i = 16u; i < 32; ++i)
-                v[i] = v[i + 16u];
-            v.resize(32);
-        } else if (image.width() <= 4) {
-            v.resize(8);
-        }
-        return v;
+            return to_block_compressed(image, algorithm);
+        SmallLevelTile tile;
+        tile.place(image, { 0, 0 });
+        tile.encode(algorithm);
+        return tile.blocks(image.width(), { 0, 0 });
     }
     }
     throw std::runtime_error("Unsupported algorithm for nucleus::Raster<glm::u8vec4>");
@@ -156,13 +157,50 @@ nucleus::utils::ColourTexture::ColourTexture(const nucleus::Raster<glm::u8vec4>&
 {
 }
 
+nucleus::utils::ColourTexture::ColourTexture(std::vector<uint8_t>&& data, unsigned width, unsigned height, Format format)
+    : m_data(std::move(data))
+    , m_width(width)
+    , m_height(height)
+    , m_format(format)
+{
+}
+
 nucleus::utils::MipmappedColourTexture nucleus::utils::generate_mipmapped_colour_texture(
     const nucleus::Raster<glm::u8vec4>& texture, ColourTexture::Format format)
 {
     auto mip_levels = nucleus::generate_mipmap(texture);
     nucleus::utils::MipmappedColourTexture colour_texture = {};
-    for (const auto& level : mip_levels) {
-        colour_texture.emplace_back(level, format);
+    colour_texture.reserve(mip_levels.size());
+    if (format == ColourTexture::Format::Uncompressed_RGBA) {
+        for (const auto& level : mip_levels)
+            colour_texture.emplace_back(level, format);
+        return colour_texture;
     }
+
+    // the 8x8 level takes 2x2 blocks, smaller levels one block each
+    constexpr std::array<glm::uvec2, 4> single_block_positions = { glm::uvec2(2, 0), glm::uvec2(3, 0), glm::uvec2(2, 1), glm::uvec2(3, 1) };
+    SmallLevelTile small_levels;
+    std::vector<std::pair<size_t, glm::uvec2>> small_level_positions;
+    size_t n_single_blocks = 0;
+    for (size_t i = 0; i < mip_levels.size(); ++i) {
+        const auto& level = mip_levels[i];
+        if (level.width() >= SmallLevelTile::size) {
+            colour_texture.emplace_back(level, format);
+            continue;
+        }
+        auto position = glm::uvec2(0, 0);
+        if (level.width() <= 4) {
+            assert(n_single_blocks < single_block_positions.size());
+            position = single_block_positions[n_single_blocks++];
+        }
+        small_levels.place(level, position);
+        small_level_positions.emplace_back(i, position);
+    }
+    if (small_level_positions.empty())
+        return colour_texture;
+
+    small_levels.encode(format);
+    for (const auto& [i, position] : small_level_positions)
+        colour_texture.emplace_back(small_levels.blocks(mip_levels[i].width(), position), mip_levels[i].width(), mip_levels[i].height(), format);
     return colour_texture;
 }
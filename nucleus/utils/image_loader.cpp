@@ -19,6 +19,11 @@
 
 #include "image_loader.h"
 
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <nucleus/RasterAllocator.h>
+
 // Limit the dimensions of images to 8192x8192. This is already quite restricting
 // in terms of that a lot of GPUs don't support textures that large. Make sure
 // you know what you are doing, before you change this value.
@@ -33,16 +38,74 @@
 // Remove if you intend to use stbi_failure_reason()
 #define STBI_NO_FAILURE_STRINGS
 
+// Decoded images are allocated as raster memory, so that Raster can adopt them without a copy. The pool is bypassed, as most
+// stb allocations are scratch buffers (zlib, idat, jpeg components) of arbitrary sizes. The adopted image is recycled once freed.
+#define STBI_MALLOC(size) nucleus::raster_memory::allocate_unpooled(size)
+#define STBI_REALLOC(ptr, size) nucleus::raster_memory::reallocate_unpooled(ptr, size)
+#define STBI_FREE(ptr) nucleus::raster_memory::deallocate_unpooled(ptr)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_slim/stb_image.h>
 
+#ifdef ALP_ENABLE_LIBJPEG_TURBO
+#include <turbojpeg.h>
+#endif
+
 #include <QFile>
 #include <tl/expected.hpp>
 
 namespace nucleus::utils::image_loader {
 
+namespace {
+#ifdef ALP_ENABLE_LIBJPEG_TURBO
+    bool is_jpeg(const QByteArray& byteArray)
+    {
+        return byteArray.size() > 3 && uchar(byteArray[0]) == 0xFF && uchar(byteArray[1]) == 0xD8 && uchar(byteArray[2]) == 0xFF;
+    }
+
+    tjhandle jpeg_decompressor()
+    {
+        // a handle can't be shared between threads, but can be reused
+        thread_local std::unique_ptr<void, decltype(&tjDestroy)> handle(tjInitDecompress(), &tjDestroy);
+        return handle.get();
+    }
+
+    tl::expected<glm::uvec2, QString> jpeg_size(const QByteArray& byteArray)
+    {
+        int width, height, subsampling, colour_space;
+        if (tjDecompressHeader3(jpeg_decompressor(), reinterpret_cast<const uchar*>(byteArray.constData()), ulong(byteArray.size()), &width, &height, &subsampling, &colour_space) != 0)
+            return tl::make_unexpected(QString("nucleus image_loader: Failed to decode jpeg header: %1").arg(tjGetErrorStr2(jpeg_decompressor())));
+        if (width > STBI_MAX_DIMENSIONS || height > STBI_MAX_DIMENSIONS)
+            return tl::make_unexpected(QString("nucleus image_loader: Jpeg image is too big (%1x%2).").arg(width).arg(height));
+        return glm::uvec2(width, height);
+    }
+
+    /// decodes straight into destination, with the given row stride in pixels
+    tl::expected<void, QString> jpeg_into(const QByteArray& byteArray, glm::u8vec4* destination, const glm::uvec2& size, size_t row_stride)
+    {
+        const auto result = tjDecompress2(jpeg_decompressor(), reinterpret_cast<const uchar*>(byteArray.constData()), ulong(byteArray.size()),
+            reinterpret_cast<uchar*>(destination), int(size.x), int(row_stride * 4), int(size.y), TJPF_RGBA, 0);
+        // warnings (e.g., slightly corrupt data) still produce an image, as with stb
+        if (result != 0 && tjGetErrorCode(jpeg_decompressor()) == TJERR_FATAL)
+            return tl::make_unexpected(QString("nucleus image_loader: Failed to decode jpeg: %1").arg(tjGetErrorStr2(jpeg_decompressor())));
+        return {};
+    }
+#endif
+} // namespace
+
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray)
 {
+#ifdef ALP_ENABLE_LIBJPEG_TURBO
+    if (is_jpeg(byteArray)) {
+        return jpeg_size(byteArray).and_then([&](const glm::uvec2& size) -> tl::expected<Raster<glm::u8vec4>, QString> {
+            raster_memory::UniqueBuffer<glm::u8vec4> buffer(static_cast<glm::u8vec4*>(raster_memory::allocate(size_t(size.x) * size.y * sizeof(glm::u8vec4))));
+            const auto result = jpeg_into(byteArray, buffer.get(), size, size.x);
+            if (!result)
+                return tl::make_unexpected(result.error());
+            return Raster<glm::u8vec4>(size, std::move(buffer));
+        });
+    }
+#endif
     int width, height, channels;
     const int requested_channels = 4; // Request 4 channels to always get RGBA8 images
     const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
@@ -57,14 +120,8 @@ tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray)
         return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
     }
 
-    // NOTE: We copy the contents of the data pointer into a Raster object. Sadly
-    // we can't use the allocated memory directly, because for that we would need a custom
-    // allocator for the std::vector class.
-    Raster<glm::u8vec4> raster(glm::uvec2(width, height));
-    memcpy(raster.data(), data, raster.size_in_bytes());
-    stbi_image_free(data);
-
-    return raster;
+    assert(raster_memory::size(data) >= size_t(width) * size_t(height) * 4);
+    return Raster<glm::u8vec4>(glm::uvec2(width, height), raster_memory::UniqueBuffer<glm::u8vec4>(reinterpret_cast<glm::u8vec4*>(data)));
 }
 
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QString& filename)
@@ -83,4 +140,52 @@ tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QString& filename)
 
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const char* filename) { return rgba8(QString(filename)); }
 
+tl::expected<void, QString> rgba8_into(const QByteArray& byteArray, glm::u8vec4* destination, const glm::uvec2& size, size_t row_stride)
+{
+    assert(row_stride >= size.x);
+#ifdef ALP_ENABLE_LIBJPEG_TURBO
+    if (is_jpeg(byteArray)) {
+        return jpeg_size(byteArray).and_then([&](const glm::uvec2& actual_size) -> tl::expected<void, QString> {
+            if (actual_size != size)
+                return tl::make_unexpected(QString("nucleus image_loader: Expected a %1x%2 image, got %3x%4.").arg(size.x).arg(size.y).arg(actual_size.x).arg(actual_size.y));
+            return jpeg_into(byteArray, destination, size, row_stride);
+        });
+    }
+#endif
+    int width, height, channels;
+    const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
+    // stb can't write into a strided destination (libjpeg-turbo can, see above). the rows are copied straight into place, and the image
+    // buffer is put into the raster pool afterwards, where it is reused by rasters of the same size.
+    raster_memory::UniqueBuffer<glm::u8vec4> data(reinterpret_cast<glm::u8vec4*>(stbi_load_from_memory(source_data, byteArray.size(), &width, &height, &channels, 4)));
+    if (data == nullptr)
+        return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
+    if (unsigned(width) != size.x || unsigned(height) != size.y)
+        return tl::make_unexpected(QString("nucleus image_loader: Expected a %1x%2 image, got %3x%4.").arg(size.x).arg(size.y).arg(width).arg(height));
+
+    for (unsigned row = 0; row < size.y; ++row)
+        std::copy_n(data.get() + size_t(row) * size.x, size.x, destination + row * row_stride);
+    return {};
+}
+
+tl::expected<Raster<uint16_t>, QString> rg8_as_u16(const QByteArray& byteArray)
+{
+    int width, height, channels;
+    const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
+    // decoded with the native channel count, height pngs are rgb. that skips stb's expansion to rgba.
+    // the 8 bit image is scratch memory of an odd size, it doesn't go into the pool.
+    const std::unique_ptr<uint8_t[], decltype(&stbi_image_free)> data(stbi_load_from_memory(source_data, byteArray.size(), &width, &height, &channels, 0), &stbi_image_free);
+    if (data == nullptr)
+        return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
+
+    // grey images are expanded to rgb by rgba8, which puts grey into red and green
+    const auto n_pixels = size_t(width) * size_t(height);
+    const auto stride = size_t(channels);
+    const auto green_offset = channels >= 3 ? 1u : 0u;
+    raster_memory::UniqueBuffer<uint16_t> buffer(static_cast<uint16_t*>(raster_memory::allocate(n_pixels * sizeof(uint16_t))));
+    const uint8_t* source = data.get();
+    for (size_t i = 0; i < n_pixels; ++i, source += stride)
+        buffer[i] = uint16_t(source[0] << 8 | source[green_offset]);
+    return Raster<uint16_t>(glm::uvec2(width, height), std::move(buffer));
+}
+
 } // namespace nucleus::utils::image_loader
@@ -30,4 +30,12 @@ tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray);
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QString& filename);
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const char* filename);
 
+/// decodes into a sub rectangle of a bigger image, e.g., a quadrant of a stitched texture. destination points to the top
+/// left pixel of the rectangle, row_stride is the width of the bigger image in pixels. fails if the size doesn't match.
+tl::expected<void, QString> rgba8_into(const QByteArray& byteArray, glm::u8vec4* destination, const glm::uvec2& size, size_t row_stride);
+
+/// decodes an 8 bit image and packs red (high byte) and green (low byte) into 16 bit, as height tiles are encoded.
+/// same result as tile::conversion::to_u16raster(rgba8(byteArray)), but without the rgba intermediate.
+tl::expected<Raster<uint16_t>, QString> rg8_as_u16(const QByteArray& byteArray);
+
 } // namespace nucleus::utils::image_loader
@@ -20,7 +20,11 @@
 
 #include <QMetaObject>
 #include <QObject>
+#include <QSemaphore>
 #include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
 
 namespace nucleus::utils::thread {
 
@@ -56,4 +60,38 @@ auto sync_call(QObject* context, Function&& fun) -> std::invoke_result_t<Functio
     return retval;
 }
 
+/// calls fun(i) for i in [0, n) using the global thread pool. the calling thread takes part and returns once all calls are done.
+/// helpers are only started if the pool has free threads, therefore it doesn't deadlock when called from within the pool.
+/// results should be written to pre-allocated slots indexed by i, so that the output order is deterministic.
+template <typename Function>
+void parallel_for(size_t n, Function&& fun)
+{
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+    if (n > 1) {
+        auto* pool = QThreadPool::globalInstance();
+        const auto n_helpers = std::min(n - 1, size_t(std::max(pool->maxThreadCount(), 1)));
+        std::atomic<size_t> next = 0;
+        const auto work = [&]() {
+            for (auto i = next++; i < n; i = next++)
+                fun(i);
+        };
+        QSemaphore done;
+        int n_started = 0;
+        for (size_t i = 0; i < n_helpers; ++i) {
+            if (!pool->tryStart([&]() {
+                    work();
+                    done.release();
+                }))
+                break;
+            ++n_started;
+        }
+        work();
+        done.acquire(n_started);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; ++i)
+        fun(i);
+}
+
 } // namespace nucleus::utils::thread
@@ -46,17 +46,18 @@ nucleus::vector_tile::PointOfInterestCollection nucleus::vector_tile::parse::poi
     if (vector_tile_data.isEmpty())
         return {};
 
-    std::string d = vector_tile_data.toStdString();
-    mapbox::vector_tile::buffer tile(d);
+    // layers are read straight from the byte array, without copying it into a std::string first
+    constexpr auto layers_tag = 3u; // tile message, see the vector tile spec
+    protozero::pbf_reader tile_reader(vector_tile_data.constData(), size_t(vector_tile_data.size()));
 
-    // create empty output variable
     std::vector<PointOfInterest> pois;
 
-    for (auto const& layer_name : tile.layerNames()) {
-        const mapbox::vector_tile::layer layer = tile.getLayer(layer_name);
-        const auto type = type_from_layer_name(layer_name);
+    while (tile_reader.next(layers_tag)) {
+        const mapbox::vector_tile::layer layer(tile_reader.get_view());
+        const auto type = type_from_layer_name(layer.getName());
 
         std::size_t feature_count = layer.featureCount();
+        pois.reserve(pois.size() + feature_count);
         for (std::size_t i = 0; i < feature_count; ++i) {
             auto const feature = mapbox::vector_tile::feature(layer.getFeature(i), layer);
             auto props = feature.getProperties();
@@ -69,31 +70,61 @@ nucleus::vector_tile::PointOfInterestCollection nucleus::vector_tile::parse::poi
             if (holds_alternative<double>(props["importance"]))
                 poi.importance = get<double>(props["importance"]);
 
-            double altitude = 0;
-            if (data_querier) {
-                const auto r = data_querier->get_altitude(lat_long);
-                if (r) {
-                    altitude = r.value();
-                } else {
-                    qWarning() << r.error() << QString(" (name: %1, id: %2, type: %3).").arg(poi.name).arg(poi.id).arg(unsigned(poi.type));
-                }
-            }
-
-            poi.lat_long_alt = glm::dvec3(lat_long.x, lat_long.y, altitude);
-            poi.world_space_pos = nucleus::srs::lat_long_alt_to_world(poi.lat_long_alt);
+            poi.lat_long_alt = glm::dvec3(lat_long.x, lat_long.y, 0);
 
+            poi.attributes.reserve(props.size());
             for (const auto& property : props) {
-                const auto name = property.first;
+                const auto& name = property.first;
                 if (name == "name" || name == "lat" || name == "long" || name == "importance")
                     continue;
-                QString value = std::visit(nucleus::vector_tile::util::string_print_visitor, property.second);
-                poi.attributes[QString::fromStdString(name)] = value;
+                poi.attributes.insert(name, std::visit(nucleus::vector_tile::util::string_print_visitor, property.second));
             }
-            poi.attributes["id"] = QString::number(get<uint64_t>(feature.getID()));
+            poi.attributes.insert("id", QString::number(get<uint64_t>(feature.getID())));
+
+            pois.emplace_back(std::move(poi));
+        }
+    }
 
-            pois.emplace_back(poi);
+    // altitudes are queried in one batch, so that the height tiles are decoded only once
+    if (data_querier) {
+        std::vector<glm::dvec2> lat_longs;
+        lat_longs.reserve(pois.size());
+        for (const auto& poi : pois)
+            lat_longs.emplace_back(poi.lat_long_alt.x, poi.lat_long_alt.y);
+        const auto altitudes = data_querier->get_altitudes(lat_longs);
+        for (size_t i = 0; i < pois.size(); ++i) {
+            auto& poi = pois[i];
+            if (altitudes[i])
+                poi.lat_long_alt.z = altitudes[i].value();
+            else
+                qWarning() << altitudes[i].error() << QString(" (name: %1, id: %2, type: %3).").arg(poi.name).arg(poi.id).arg(unsigned(poi.type));
         }
     }
+    for (auto& poi : pois)
+        poi.world_space_pos = nucleus::srs::lat_long_alt_to_world(poi.lat_long_alt);
 
     return pois;
 }
+
+nucleus::vector_tile::PoiColumns nucleus::vector_tile::parse::columns(const PointOfInterestCollection& pois)
+{
+    PoiColumns columns;
+    columns.types.reserve(pois.size());
+    columns.elevations.reserve(pois.size());
+    columns.features.reserve(pois.size());
+    for (const auto& poi : pois) {
+        columns.types.push_back(poi.type);
+        columns.elevations.push_back(float(poi.lat_long_alt.z));
+        uint8_t features = 0;
+        if (poi.attributes.value("summit_cross") == "yes")
+            features |= PoiColumns::SummitCross;
+        if (poi.attributes.value("summit_register") == "yes")
+            features |= PoiColumns::SummitRegister;
+        if (poi.attributes.value("shower") == "yes")
+            features |= PoiColumns::Shower;
+        if (poi.attributes.contains("email") || poi.attributes.contains("phone"))
+            features |= PoiColumns::Contact;
+        columns.features.push_back(features);
+    }
+    return columns;
+}
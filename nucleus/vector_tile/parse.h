@@ -26,4 +26,5 @@
 
 namespace nucleus::vector_tile::parse {
 PointOfInterestCollection points_of_interest(const QByteArray& vector_tile_data, const DataQuerier* data_querier = nullptr);
+PoiColumns columns(const PointOfInterestCollection& pois);
 }
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ * Copyright (C) 2026 Lucas Dworschak
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "types.h"
+
+#include <cassert>
+#include <deque>
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace {
+struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view> {}(key); }
+};
+
+struct KeyRegistry {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, uint16_t, KeyHash, std::equal_to<>> ids;
+    std::deque<QString> names; // deque, so that references stay valid on insertion
+};
+
+KeyRegistry& key_registry()
+{
+    static KeyRegistry registry;
+    return registry;
+}
+} // namespace
+
+namespace nucleus::vector_tile {
+
+uint16_t attribute_keys::intern(std::string_view key)
+{
+    auto& registry = key_registry();
+    {
+        std::shared_lock lock(registry.mutex);
+        if (const auto iter = registry.ids.find(key); iter != registry.ids.end())
+            return iter->second;
+    }
+    std::unique_lock lock(registry.mutex);
+    const auto [iter, inserted] = registry.ids.try_emplace(std::string(key), uint16_t(registry.names.size()));
+    if (inserted) {
+        assert(registry.names.size() < std::numeric_limits<uint16_t>::max());
+        registry.names.push_back(QString::fromUtf8(key.data(), qsizetype(key.size())));
+    }
+    return iter->second;
+}
+
+std::optional<uint16_t> attribute_keys::find(std::string_view key)
+{
+    auto& registry = key_registry();
+    std::shared_lock lock(registry.mutex);
+    if (const auto iter = registry.ids.find(key); iter != registry.ids.end())
+        return iter->second;
+    return {};
+}
+
+const QString& attribute_keys::name(uint16_t key)
+{
+    auto& registry = key_registry();
+    std::shared_lock lock(registry.mutex);
+    assert(key < registry.names.size());
+    return registry.names[key];
+}
+
+void PoiAttributes::insert(std::string_view key, QString value)
+{
+    const auto id = attribute_keys::intern(key);
+    for (auto& entry : m_entries) {
+        if (entry.key == id) {
+            entry.value = std::move(value);
+            return;
+        }
+    }
+    m_entries.push_back({ id, std::move(value) });
+}
+
+const PoiAttributes::Entry* PoiAttributes::find(std::string_view key) const
+{
+    const auto id = attribute_keys::find(key);
+    if (!id)
+        return nullptr;
+    for (const auto& entry : m_entries) {
+        if (entry.key == *id)
+            return &entry;
+    }
+    return nullptr;
+}
+
+bool PoiAttributes::contains(std::string_view key) const { return find(key) != nullptr; }
+
+QString PoiAttributes::value(std::string_view key) const
+{
+    const auto* entry = find(key);
+    return entry ? entry->value : QString();
+}
+
+} // namespace nucleus::vector_tile
@@ -19,17 +19,50 @@
 
 #pragma once
 
-#include <QHash>
 #include <QObject>
 #include <QString>
-#include <QVariantHash>
 #include <cstdint>
 #include <glm/glm.hpp>
+#include <optional>
+#include <string_view>
+#include <vector>
 #include <nucleus/tile/types.h>
 #include <radix/tile.h>
 
 namespace nucleus::vector_tile {
 
+/// attribute keys are interned into small integers, which are the same for all tiles. thread safe.
+namespace attribute_keys {
+    [[nodiscard]] uint16_t intern(std::string_view key);
+    /// doesn't insert, returns an empty optional for keys that were never interned.
+    [[nodiscard]] std::optional<uint16_t> find(std::string_view key);
+    /// the returned reference stays valid for the lifetime of the program.
+    [[nodiscard]] const QString& name(uint16_t key);
+} // namespace attribute_keys
+
+/// compact attributes of a point of interest: a flat vector of interned keys and their string values.
+class PoiAttributes {
+public:
+    struct Entry {
+        uint16_t key;
+        QString value;
+    };
+
+    void reserve(size_t n) { m_entries.reserve(n); }
+    void insert(std::string_view key, QString value);
+    [[nodiscard]] bool contains(std::string_view key) const;
+    /// returns an empty string for attributes that don't exist.
+    [[nodiscard]] QString value(std::string_view key) const;
+    [[nodiscard]] QString operator[](std::string_view key) const { return value(key); }
+    [[nodiscard]] size_t size() const { return m_entries.size(); }
+    [[nodiscard]] std::vector<Entry>::const_iterator begin() const { return m_entries.cbegin(); }
+    [[nodiscard]] std::vector<Entry>::const_iterator end() const { return m_entries.cend(); }
+
+private:
+    [[nodiscard]] const Entry* find(std::string_view key) const;
+    std::vector<Entry> m_entries;
+};
+
 struct PointOfInterest {
     Q_GADGET
 public:
@@ -41,15 +74,28 @@ public:
     glm::dvec3 lat_long_alt = glm::dvec3(0);
     glm::dvec3 world_space_pos = glm::dvec3(0);
     float importance = 0;
-    QVariantHash attributes;
+    PoiAttributes attributes;
 };
 
 using PointOfInterestCollection = std::vector<PointOfInterest>;
 using PointOfInterestCollectionPtr = std::shared_ptr<const PointOfInterestCollection>;
 
+/// the properties used for filtering, column wise and parallel to a PointOfInterestCollection. computed once at parse time.
+struct PoiColumns {
+    enum Feature : uint8_t { SummitCross = 1, SummitRegister = 2, Shower = 4, Contact = 8 };
+    std::vector<PointOfInterest::Type> types;
+    std::vector<float> elevations;
+    std::vector<uint8_t> features; // bitmask of Feature
+};
+using PoiColumnsPtr = std::shared_ptr<const PoiColumns>;
+using PoiIndices = std::vector<uint32_t>;
+using PoiIndicesPtr = std::shared_ptr<const PoiIndices>;
+
 struct PoiTile {
     tile::Id id;
     vector_tile::PointOfInterestCollectionPtr data;
+    vector_tile::PoiColumnsPtr columns;
+    vector_tile::PoiIndicesPtr visible; // indices into data that passed the filter. all are visible if null
 };
 static_assert(tile::NamedTile<PoiTile>);
 
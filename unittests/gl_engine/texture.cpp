@@ -222,6 +222,18 @@ TEST_CASE("gl texture")
             const auto compressed = ColourTexture(test_raster, ColourTexture::Format::Uncompressed_RGBA);
             CHECK(compressed.n_bytes() == 256 * 256 * 4);
         }
+        for (const auto format : { ColourTexture::Format::DXT1, ColourTexture::Format::ETC1 }) {
+            // small levels are encoded together, bigger ones in bands. the result must not depend on that.
+            const auto levels = nucleus::generate_mipmap(test_raster);
+            const auto mipmapped = generate_mipmapped_colour_texture(test_raster, format);
+            REQUIRE(mipmapped.size() == levels.size());
+            for (size_t i = 0; i < levels.size(); ++i) {
+                const auto single = ColourTexture(levels[i], format);
+                CHECK(mipmapped[i].width() == levels[i].width());
+                CHECK(mipmapped[i].n_bytes() == std::max(levels[i].width() / 4, 1u) * std::max(levels[i].height() / 4, 1u) * 8);
+                CHECK(std::equal(single.data(), single.data() + single.n_bytes(), mipmapped[i].data(), mipmapped[i].data() + mipmapped[i].n_bytes()));
+            }
+        }
     }
 
     SECTION("verify test methodology")
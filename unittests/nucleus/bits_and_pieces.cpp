@@ -76,6 +76,24 @@ TEST_CASE("nucleus/bits_and_pieces: image loading")
     }
 }
 
+TEST_CASE("nucleus/bits_and_pieces: image loading into a sub rectangle")
+{
+    nucleus::Raster<glm::u8vec4> canvas({ 16, 12 }, glm::u8vec4(1, 2, 3, 4));
+    const auto offset = glm::uvec2(8, 4);
+    const auto result = nucleus::utils::image_loader::rgba8_into(test_helpers::black_png_tile(8), &canvas.pixel(offset), { 8, 8 }, canvas.width());
+    REQUIRE(result);
+    for (unsigned y = 0; y < canvas.height(); ++y) {
+        for (unsigned x = 0; x < canvas.width(); ++x) {
+            const auto inside = x >= offset.x && y >= offset.y;
+            CHECK(canvas.pixel({ x, y }) == (inside ? glm::u8vec4(0, 0, 0, 255) : glm::u8vec4(1, 2, 3, 4)));
+        }
+    }
+
+    // size mismatch
+    CHECK(!nucleus::utils::image_loader::rgba8_into(test_helpers::black_png_tile(4), canvas.data(), { 8, 8 }, canvas.width()));
+    CHECK(!nucleus::utils::image_loader::rgba8_into(QByteArray("garbage"), canvas.data(), { 8, 8 }, canvas.width()));
+}
+
 TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::thread::async_call")
 {
     QThread bg_thread;
@@ -140,3 +158,25 @@ TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::thread::sync_call int")
     bg_thread.quit();
     bg_thread.wait(500); // msec
 }
+
+TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::thread::parallel_for")
+{
+    SECTION("every index is visited exactly once")
+    {
+        std::vector<std::atomic<int>> visits(1000);
+        nucleus::utils::thread::parallel_for(visits.size(), [&](size_t i) { ++visits[i]; });
+        CHECK(std::ranges::all_of(visits, [](const auto& v) { return v == 1; }));
+    }
+    SECTION("empty range")
+    {
+        bool called = false;
+        nucleus::utils::thread::parallel_for(0, [&](size_t) { called = true; });
+        CHECK(!called);
+    }
+    SECTION("nested calls don't deadlock")
+    {
+        std::atomic<int> sum = 0;
+        nucleus::utils::thread::parallel_for(64, [&](size_t) { nucleus::utils::thread::parallel_for(64, [&](size_t) { ++sum; }); });
+        CHECK(sum == 64 * 64);
+    }
+}
@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *****************************************************************************/
 
+#include "nucleus/HeightSampler.h"
 #include "nucleus/tile/Cache.h"
 #include "nucleus/tile/cache_quieries.h"
 #include "nucleus/tile/types.h"
@@ -75,3 +76,44 @@ TEST_CASE("cache_queries")
     CHECK(cache_queries::query_altitude(&cache, {-47.5587933, -12.3450985}) == 3000);
     CHECK(cache_queries::query_altitude(&cache, {47.5587933, 12.3450985}) == 2000);
 }
+
+TEST_CASE("cache_queries: batched altitudes")
+{
+    MemoryCache cache;
+    cache.insert(example_tile_quad_for(Id { 0, { 0, 0 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 0, 0 } }, 3000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 0, 1 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 1, 0 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 1, 1 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 2, { 2, 2 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 3, { 4, 5 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 4, { 8, 10 } }, 2000.0f));
+
+    const std::vector<glm::dvec2> lat_longs = { { 47.5587933, -12.3450985 }, { -47.5587933, -12.3450985 }, { 47.5587933, 12.3450985 }, { 47.5, 12.3 }, { 47.6, 12.4 } };
+    const nucleus::HeightSampler sampler(&cache);
+    const auto altitudes = cache_queries::query_altitudes(sampler, lat_longs);
+    REQUIRE(altitudes.size() == lat_longs.size());
+    CHECK(altitudes[0] == 1000);
+    CHECK(altitudes[1] == 3000);
+    CHECK(altitudes[2] == 2000);
+    CHECK(altitudes[3] == 2000);
+    CHECK(altitudes[4] == 2000);
+    for (size_t i = 0; i < lat_longs.size(); ++i)
+        CHECK(altitudes[i] == cache_queries::query_altitude(&cache, lat_longs[i]));
+
+    // the last three points are in the same tile, which is decoded only once
+    CHECK(sampler.n_decoded_tiles() == 3);
+
+    // and reused in the next call
+    const auto again = cache_queries::query_altitudes(sampler, lat_longs);
+    CHECK(again == altitudes);
+    CHECK(sampler.n_decoded_tiles() == 3);
+
+    SECTION("points without data yield an error")
+    {
+        MemoryCache empty;
+        const auto r = cache_queries::query_altitudes(&empty, lat_longs);
+        REQUIRE(r.size() == lat_longs.size());
+        CHECK(!r[0].has_value());
+    }
+}
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "nucleus/HeightSampler.h"
+#include "nucleus/srs.h"
+#include "nucleus/tile/Cache.h"
+#include "radix/height_encoding.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <QBuffer>
+#include <QImage>
+
+using namespace nucleus::tile;
+using nucleus::HeightSampler;
+
+namespace {
+constexpr unsigned tile_size = 65;
+
+// altitudes are multiples of 1/8 m, so they survive the encoding without loss
+float altitude_at(const glm::uvec2& pixel, float base) { return base + 10.0f * float(pixel.x) + 20.0f * float(pixel.y); }
+
+QByteArray png_tile(float base)
+{
+    QImage tile(QSize { int(tile_size), int(tile_size) }, QImage::Format_ARGB32);
+    for (unsigned y = 0; y < tile_size; ++y) {
+        for (unsigned x = 0; x < tile_size; ++x) {
+            const auto rgb = radix::height_encoding::to_rgb(altitude_at({ x, y }, base));
+            tile.setPixelColor(int(x), int(y), QColor(rgb.x, rgb.y, rgb.z));
+        }
+    }
+    QByteArray arr;
+    QBuffer buffer(&arr);
+    buffer.open(QIODevice::WriteOnly);
+    tile.save(&buffer, "PNG");
+    return arr;
+}
+
+DataQuad quad_for(const Id& id, float base)
+{
+    const auto children = id.children();
+    DataQuad quad;
+    quad.id = id;
+    quad.n_tiles = 4;
+    const auto data = png_tile(base);
+    for (unsigned i = 0; i < 4; ++i) {
+        quad.tiles[i].id = children[i];
+        quad.tiles[i].data = std::make_shared<QByteArray>(data);
+        quad.tiles[i].network_info.status = NetworkInfo::Status::Good;
+        quad.tiles[i].network_info.timestamp = nucleus::utils::time_since_epoch();
+    }
+    return quad;
+}
+
+// lat long of a (possibly fractional) pixel position of a tile, y down as in the image
+glm::dvec2 lat_long_of(const Id& id, const glm::dvec2& pixel)
+{
+    const auto bounds = nucleus::srs::tile_bounds(id);
+    const auto uv = glm::dvec2(pixel.x, double(tile_size - 1) - pixel.y) / double(tile_size - 1);
+    return nucleus::srs::world_to_lat_long(bounds.min + uv * bounds.size());
+}
+
+float encoded(float altitude) { return radix::height_encoding::to_float(radix::height_encoding::to_rgb(altitude)); }
+} // namespace
+
+TEST_CASE("nucleus/HeightSampler")
+{
+    MemoryCache cache;
+    cache.insert(quad_for(Id { 0, { 0, 0 } }, 1000.0f));
+    cache.insert(quad_for(Id { 1, { 1, 1 } }, 2000.0f));
+    HeightSampler sampler(&cache);
+    const auto fine_tile = Id { 1, { 1, 1 } }.children()[0];
+
+    SECTION("samples on texels match the height encoding")
+    {
+        std::vector<glm::dvec2> lat_longs;
+        std::vector<float> expected;
+        for (unsigned y = 1; y < tile_size - 1; y += 7) {
+            for (unsigned x = 1; x < tile_size - 1; x += 5) {
+                lat_longs.push_back(lat_long_of(fine_tile, { x, y }));
+                expected.push_back(encoded(altitude_at({ x, y }, 2000.0f)));
+            }
+        }
+        const auto samples = sampler.sample(lat_longs);
+        REQUIRE(samples.size() == expected.size());
+        for (size_t i = 0; i < samples.size(); ++i) {
+            REQUIRE(samples[i].has_value());
+            CHECK(samples[i]->zoom_level == 2);
+            CHECK(std::abs(samples[i]->altitude - expected[i]) < 0.01f);
+        }
+        CHECK(sampler.n_decoded_tiles() == 1);
+    }
+
+    SECTION("samples between texels are interpolated bilinearly")
+    {
+        const auto a = encoded(altitude_at({ 10, 20 }, 2000.0f));
+        const auto b = encoded(altitude_at({ 11, 20 }, 2000.0f));
+        const auto c = encoded(altitude_at({ 10, 21 }, 2000.0f));
+        const auto d = encoded(altitude_at({ 11, 21 }, 2000.0f));
+        const auto half = sampler.sample(lat_long_of(fine_tile, { 10.5, 20.0 }));
+        REQUIRE(half);
+        CHECK(std::abs(half->altitude - (a + b) / 2) < 0.01f);
+        const auto quarter = sampler.sample(lat_long_of(fine_tile, { 10.25, 20.75 }));
+        REQUIRE(quarter);
+        const auto expected = (a * 0.75f + b * 0.25f) * 0.25f + (c * 0.75f + d * 0.25f) * 0.75f;
+        CHECK(std::abs(quarter->altitude - expected) < 0.01f);
+    }
+
+    SECTION("max zoom level selects coarser tiles")
+    {
+        const auto position = lat_long_of(fine_tile, { 32, 32 });
+        const auto fine = sampler.sample(position);
+        REQUIRE(fine);
+        CHECK(fine->zoom_level == 2);
+        const auto coarse = sampler.sample(position, 1);
+        REQUIRE(coarse);
+        CHECK(coarse->zoom_level == 1);
+        CHECK(coarse->altitude < fine->altitude); // coarse tiles are based on 1000m, and the position is not in their bottom right corner
+        CHECK(sampler.n_decoded_tiles() == 2);
+        CHECK(!sampler.sample(position, 0));
+    }
+
+    SECTION("points outside of the cache yield no sample")
+    {
+        MemoryCache empty;
+        HeightSampler empty_sampler(&empty);
+        CHECK(!empty_sampler.sample(lat_long_of(fine_tile, { 32, 32 })));
+    }
+
+    SECTION("decoded pyramid is bounded")
+    {
+        HeightSampler small_sampler(&cache, tile_size * tile_size * sizeof(uint16_t));
+        CHECK(small_sampler.sample(lat_long_of(fine_tile, { 32, 32 })));
+        CHECK(small_sampler.sample(lat_long_of(fine_tile, { 32, 32 }), 1));
+        CHECK(small_sampler.n_decoded_tiles() == 1);
+        CHECK(small_sampler.n_decoded_bytes() <= tile_size * tile_size * sizeof(uint16_t));
+    }
+}
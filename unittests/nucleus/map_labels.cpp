@@ -18,8 +18,12 @@
 
 #include <QDebug>
 #include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryFile>
 #include <catch2/catch_test_macros.hpp>
+#include <nucleus/map_label/Declutter.h>
 #include <nucleus/map_label/Factory.h>
+#include <nucleus/map_label/Filter.h>
 #include <nucleus/tile/conversion.h>
 
 TEST_CASE("nucleus/map_label/factory")
@@ -41,3 +45,229 @@ TEST_CASE("nucleus/map_label/factory")
         qimage.save(QString("font_atlas_%0.png").arg(i));
     }
 }
+
+TEST_CASE("nucleus/map_label/font atlas serialisation")
+{
+    using nucleus::map_label::FontRenderer;
+    FontRenderer a;
+    a.init();
+    a.render({ u'a', u'b', u'Ž' }, 48.0f);
+    const auto initial = a.take_changed_pages();
+    CHECK(initial.changed);
+    CHECK(initial.page_indices == std::vector<unsigned> { 0 });
+    CHECK(!a.take_changed_pages().changed);
+    const auto bytes = a.serialise(48.0f);
+    REQUIRE(!bytes.empty());
+
+    FontRenderer b;
+    b.init();
+    CHECK(!b.deserialise(bytes, 32.0f).has_value()); // different font size
+    REQUIRE(b.deserialise(bytes, 48.0f).has_value());
+    CHECK(b.font_data().char_data.size() == 3);
+    CHECK(b.font_atlas().front().buffer() == a.font_atlas().front().buffer());
+
+    // rendering continues where it left off
+    a.render({ u'c' }, 48.0f);
+    b.render({ u'c' }, 48.0f);
+    const auto& ca = a.font_data().char_data.at(u'c');
+    const auto& cb = b.font_data().char_data.at(u'c');
+    CHECK(ca.x == cb.x);
+    CHECK(ca.y == cb.y);
+    CHECK(ca.texture_index == cb.texture_index);
+    CHECK(a.take_changed_pages().page_indices == std::vector<unsigned> { 0 });
+    CHECK(b.font_atlas().front().buffer() == a.font_atlas().front().buffer());
+
+    auto broken = bytes;
+    broken.resize(broken.size() / 2);
+    CHECK(!b.deserialise(broken, 48.0f).has_value());
+}
+
+TEST_CASE("nucleus/map_label/font atlas patching")
+{
+    using nucleus::map_label::FontRenderer;
+    FontRenderer renderer;
+    renderer.init();
+    renderer.render({ u'a', u'b', u'Ž' }, 48.0f);
+
+    QTemporaryFile file;
+    REQUIRE(file.open());
+    REQUIRE(FontRenderer::patch(&file, renderer.take_snapshot(48.0f)).has_value());
+
+    // later snapshots contain only the pages with new glyphs
+    CHECK(renderer.take_snapshot(48.0f).pages.empty());
+    renderer.render({ u'c' }, 48.0f);
+    const auto snapshot = renderer.take_snapshot(48.0f);
+    CHECK(snapshot.page_indices == std::vector<unsigned> { 0 });
+    REQUIRE(FontRenderer::patch(&file, snapshot).has_value());
+
+    REQUIRE(file.seek(0));
+    const auto patched = file.readAll();
+    const auto serialised = renderer.serialise(48.0f);
+    CHECK(patched == QByteArray(serialised.data(), qsizetype(serialised.size())));
+
+    FontRenderer read_back;
+    read_back.init();
+    REQUIRE(read_back.deserialise(std::span<const char>(patched.constData(), size_t(patched.size())), 48.0f).has_value());
+    CHECK(read_back.font_data().char_data.size() == 4);
+    CHECK(read_back.take_snapshot(48.0f).pages.empty()); // the pages are on disk already
+
+    // an empty file can't be patched with an incomplete snapshot
+    QTemporaryFile empty;
+    REQUIRE(empty.open());
+    CHECK(!FontRenderer::patch(&empty, renderer.take_snapshot(48.0f)).has_value());
+
+    // after a failed write, the next snapshot is complete and can start from scratch
+    renderer.mark_all_pages_unpersisted();
+    REQUIRE(FontRenderer::patch(&empty, renderer.take_snapshot(48.0f)).has_value());
+    REQUIRE(empty.seek(0));
+    CHECK(empty.readAll() == QByteArray(serialised.data(), qsizetype(serialised.size())));
+}
+
+TEST_CASE("nucleus/map_label/filter")
+{
+    using Type = nucleus::vector_tile::PointOfInterest::Type;
+    using nucleus::vector_tile::PoiColumns;
+    PoiColumns columns;
+    columns.types = { Type::Peak, Type::Peak, Type::Peak, Type::Settlement, Type::AlpineHut, Type::AlpineHut, Type::Webcam };
+    columns.elevations = { 1000, 3000, 5000, 200, 2000, 2000, 1500 };
+    columns.features = { PoiColumns::SummitCross, 0, PoiColumns::SummitCross, 0, PoiColumns::Shower | PoiColumns::Contact, PoiColumns::Contact, 0 };
+
+    nucleus::map_label::Filter filter;
+    nucleus::map_label::FilterDefinitions definitions;
+    filter.update_filter(definitions);
+    CHECK(filter.apply_filter(columns) == nucleus::vector_tile::PoiIndices { 0, 1, 3, 4, 5, 6 }); // 5000m peak is outside the default range
+
+    definitions.m_peak_ele_range = QVector2D(0, 6000);
+    definitions.m_peak_has_cross = true;
+    definitions.m_cottage_has_shower = true;
+    definitions.m_webcams_visible = false;
+    filter.update_filter(definitions);
+    CHECK(filter.apply_filter(columns) == nucleus::vector_tile::PoiIndices { 0, 2, 3, 4 });
+
+    definitions.m_cities_visible = false;
+    definitions.m_cottages_visible = false;
+    filter.update_filter(definitions);
+    CHECK(filter.apply_filter(columns) == nucleus::vector_tile::PoiIndices { 0, 2 });
+}
+
+TEST_CASE("nucleus/map_label/filter incremental updates")
+{
+    using Type = nucleus::vector_tile::PointOfInterest::Type;
+    using namespace nucleus::vector_tile;
+    const auto make_tile = [](const nucleus::tile::Id& id, std::vector<Type> types, std::vector<float> elevations) {
+        PoiTile tile;
+        tile.id = id;
+        tile.data = std::make_shared<PointOfInterestCollection>(types.size());
+        auto columns = std::make_shared<PoiColumns>();
+        columns->features.resize(types.size());
+        columns->types = std::move(types);
+        columns->elevations = std::move(elevations);
+        tile.columns = columns;
+        return tile;
+    };
+    const auto peaks = make_tile({ 10, { 1, 1 } }, { Type::Peak, Type::Peak }, { 1000, 3000 });
+    const auto huts = make_tile({ 10, { 1, 2 } }, { Type::AlpineHut }, { 2000 });
+
+    nucleus::map_label::Filter filter;
+    QSignalSpy spy(&filter, &nucleus::map_label::Filter::filter_finished);
+    filter.update_quads({ peaks, huts }, {});
+    REQUIRE(spy.size() == 1);
+    CHECK(spy[0][0].value<std::vector<PoiTile>>().size() == 2);
+
+    nucleus::map_label::FilterDefinitions definitions;
+    definitions.m_peak_ele_range = QVector2D(0, 3500); // visible set of the peaks doesn't change
+    filter.update_filter(definitions);
+    CHECK(spy.size() == 1);
+
+    spy.wait(600); // wait for the rate limiting timer
+    definitions.m_peak_ele_range = QVector2D(0, 2000);
+    filter.update_filter(definitions);
+    REQUIRE(spy.size() == 2);
+    const auto updated = spy[1][0].value<std::vector<PoiTile>>();
+    REQUIRE(updated.size() == 1); // only the tile with peaks
+    CHECK(updated[0].id == peaks.id);
+    REQUIRE(updated[0].visible);
+    CHECK(*updated[0].visible == PoiIndices { 0 });
+
+    CHECK(nucleus::map_label::Filter::affected_types(definitions, definitions) == 0);
+}
+
+TEST_CASE("nucleus/map_label/declutter")
+{
+    using nucleus::map_label::Declutter;
+    using Candidate = Declutter::Candidate;
+    const auto viewport = glm::vec2(800, 600);
+
+    SECTION("importance wins")
+    {
+        const std::vector<Candidate> candidates = {
+            { { 100, 100 }, { 200, 150 }, 0.2f, false },
+            { { 150, 120 }, { 250, 170 }, 0.9f, false }, // overlaps the first
+            { { 300, 100 }, { 400, 150 }, 0.1f, false },
+            { { 1000, 100 }, { 1100, 150 }, 1.0f, false }, // off screen
+        };
+        CHECK(Declutter::select(candidates, viewport, 64) == std::vector<bool> { false, true, true, false });
+    }
+    SECTION("previously selected labels win ties")
+    {
+        const std::vector<Candidate> candidates = {
+            { { 100, 100 }, { 200, 150 }, 0.5f, false },
+            { { 150, 120 }, { 250, 170 }, 0.5f, true },
+        };
+        CHECK(Declutter::select(candidates, viewport, 64) == std::vector<bool> { false, true });
+    }
+    SECTION("labels spanning many cells")
+    {
+        const std::vector<Candidate> candidates = {
+            { { 0, 0 }, { 800, 20 }, 0.5f, false },
+            { { 700, 10 }, { 710, 30 }, 0.4f, false },
+            { { 700, 21 }, { 710, 30 }, 0.3f, false },
+        };
+        CHECK(Declutter::select(candidates, viewport, 64) == std::vector<bool> { true, false, true });
+    }
+    SECTION("unprocessed labels keep their state after the deadline")
+    {
+        const std::vector<Candidate> candidates = {
+            { { 100, 100 }, { 200, 150 }, 0.5f, true },
+            { { 150, 120 }, { 250, 170 }, 0.9f, false },
+        };
+        CHECK(Declutter::select(candidates, viewport, 64, QDeadlineTimer(0)) == std::vector<bool> { true, false });
+    }
+    SECTION("placement continues after the deadline")
+    {
+        const std::vector<Candidate> candidates = {
+            { { 100, 100 }, { 200, 150 }, 0.5f, true },
+            { { 150, 120 }, { 250, 170 }, 0.9f, false },
+            { { 300, 100 }, { 400, 150 }, 0.1f, false },
+        };
+        Declutter::Placement placement(candidates, viewport, 64);
+        CHECK(!placement.run(QDeadlineTimer(0)));
+        CHECK(!placement.done());
+        CHECK(placement.selection() == std::vector<bool> { true, false, false });
+        CHECK(placement.processed() == std::vector<bool> { false, false, false });
+        CHECK(placement.run());
+        CHECK(placement.done());
+        CHECK(placement.processed() == std::vector<bool> { true, true, true });
+        CHECK(placement.selection() == std::vector<bool> { false, true, true });
+        CHECK(placement.selection() == Declutter::select(candidates, viewport, 64));
+    }
+    SECTION("projection")
+    {
+        nucleus::vector_tile::PointOfInterest poi;
+        poi.type = nucleus::vector_tile::PointOfInterest::Type::Peak;
+        poi.name = "Großglockner";
+        poi.importance = 1.0f;
+        poi.world_space_pos = { 0, 0, 0.5 };
+        const auto candidate = Declutter::project(poi, glm::dmat4(1), viewport);
+        REQUIRE(candidate);
+        CHECK(candidate->min.x < 400);
+        CHECK(candidate->max.x > 400);
+        CHECK(candidate->min.y < 300); // text is above the anchor
+        CHECK(candidate->max.y > 300);
+        CHECK(candidate->max.x - candidate->min.x > candidate->max.y - candidate->min.y);
+
+        auto behind = glm::dmat4(1);
+        behind[3][3] = -1;
+        CHECK(!Declutter::project(poi, behind, viewport));
+    }
+}
@@ -18,13 +18,45 @@
 
 #include "catch2_helpers.h"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <glm/glm.hpp>
+#include <random>
 
 #include "nucleus/Raster.h"
 #include "test_helpers.h"
 
 using nucleus::Raster;
 
+namespace {
+// the original, column major implementation of a mipmap level. used as a reference
+template <typename T> Raster<T> reference_downsample(const Raster<T>& u)
+{
+    Raster<T> r(u.size() / 2u);
+    for (unsigned i = 0u; i < r.width(); ++i) {
+        for (unsigned j = 0u; j < r.height(); ++j) {
+            r.pixel({ i, j }) = nucleus::detail::avg(u.pixel({ i * 2, j * 2 }), u.pixel({ i * 2, j * 2 + 1 }), u.pixel({ i * 2 + 1, j * 2 }), u.pixel({ i * 2 + 1, j * 2 + 1 }));
+        }
+    }
+    return r;
+}
+
+template <typename T> Raster<T> random_raster(unsigned size)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<unsigned> dist(0, 65535);
+    Raster<T> raster(glm::uvec2(size));
+    for (auto& p : raster) {
+        if constexpr (std::is_same_v<T, glm::u8vec4>)
+            p = glm::u8vec4(dist(rng) & 255, dist(rng) & 255, dist(rng) & 255, dist(rng) & 255);
+        else if constexpr (std::is_same_v<T, float>)
+            p = float(dist(rng)) / 100.0f;
+        else
+            p = T(dist(rng));
+    }
+    return raster;
+}
+} // namespace
+
 TEST_CASE("nucleus/Raster")
 {
     SECTION("empty and interface")
@@ -249,3 +281,200 @@ TEST_CASE("nucleus/Raster")
         CHECK(result.pixel({ 3, 1 }) == 657);
     }
 }
+
+TEST_CASE("nucleus/raster_memory")
+{
+    using namespace nucleus;
+    SECTION("rasters are aligned and cleared")
+    {
+        raster_memory::clear();
+        const auto before = raster_memory::statistics();
+        Raster<uint16_t> a(glm::uvec2(65, 65));
+        CHECK(reinterpret_cast<uintptr_t>(a.data()) % raster_memory::alignment == 0);
+        std::fill(a.begin(), a.end(), uint16_t(12));
+        a = {};
+        // recycled memory must be cleared as well
+        const Raster<uint16_t> b(glm::uvec2(65, 65));
+        CHECK(raster_memory::statistics().n_hits == before.n_hits + 1);
+        CHECK(std::all_of(b.begin(), b.end(), [](auto v) { return v == 0; }));
+    }
+    SECTION("blocks are recycled")
+    {
+        raster_memory::clear();
+        const auto before = raster_memory::statistics();
+        {
+            const Raster<glm::u8vec4> a(glm::uvec2(256, 256));
+        }
+        CHECK(raster_memory::statistics().n_pooled_bytes == 256 * 256 * 4);
+        {
+            const Raster<glm::u8vec4> a(glm::uvec2(256, 256));
+            CHECK(raster_memory::statistics().n_pooled_bytes == 0);
+        }
+        CHECK(raster_memory::statistics().n_hits == before.n_hits + 1);
+        raster_memory::clear();
+        CHECK(raster_memory::statistics().n_pooled_bytes == 0);
+    }
+    SECTION("adopt buffer")
+    {
+        auto* memory = static_cast<glm::u8vec4*>(raster_memory::allocate(64 * 32 * sizeof(glm::u8vec4)));
+        for (unsigned i = 0; i < 64 * 32; ++i)
+            memory[i] = glm::u8vec4(i & 255, 1, 2, 3);
+        const Raster<glm::u8vec4> raster(glm::uvec2(64, 32), raster_memory::UniqueBuffer<glm::u8vec4>(memory));
+        CHECK(raster.data() == memory);
+        CHECK(raster.width() == 64);
+        CHECK(raster.height() == 32);
+        CHECK(raster.pixel({ 5, 1 }) == glm::u8vec4(69, 1, 2, 3));
+
+        const auto copy = raster;
+        CHECK(copy.data() != raster.data());
+        CHECK(copy.buffer() == raster.buffer());
+    }
+    SECTION("least recently used sizes are evicted")
+    {
+        raster_memory::clear();
+        const auto block_size = [](size_t i) { return size_t(16) * 1024 * 1024 + i * 4096; };
+        for (size_t i = 0; i < 5; ++i)
+            raster_memory::deallocate(raster_memory::allocate(block_size(i)));
+        CHECK(raster_memory::statistics().n_pooled_bytes == block_size(2) + block_size(3) + block_size(4));
+        const auto before = raster_memory::statistics();
+        raster_memory::deallocate(raster_memory::allocate(block_size(0)));
+        CHECK(raster_memory::statistics().n_misses == before.n_misses + 1);
+        raster_memory::deallocate(raster_memory::allocate(block_size(3)));
+        CHECK(raster_memory::statistics().n_hits == before.n_hits + 1);
+        raster_memory::clear();
+    }
+    SECTION("unpooled memory bypasses the pool")
+    {
+        raster_memory::clear();
+        const auto before = raster_memory::statistics();
+        auto* memory = static_cast<uint8_t*>(raster_memory::allocate_unpooled(5000));
+        CHECK(reinterpret_cast<uintptr_t>(memory) % raster_memory::alignment == 0);
+        memory = static_cast<uint8_t*>(raster_memory::reallocate_unpooled(memory, 7000));
+        CHECK(raster_memory::size(memory) == 7000);
+        raster_memory::deallocate_unpooled(memory);
+        CHECK(raster_memory::statistics().n_pooled_bytes == 0);
+        CHECK(raster_memory::statistics().n_misses == before.n_misses);
+
+        // but it can be adopted and is recycled afterwards
+        auto* pixels = static_cast<glm::u8vec4*>(raster_memory::allocate_unpooled(64 * 32 * sizeof(glm::u8vec4)));
+        {
+            const Raster<glm::u8vec4> raster(glm::uvec2(64, 32), raster_memory::UniqueBuffer<glm::u8vec4>(pixels));
+            CHECK(raster.data() == pixels);
+        }
+        CHECK(raster_memory::statistics().n_pooled_bytes == 64 * 32 * sizeof(glm::u8vec4));
+        raster_memory::clear();
+    }
+    SECTION("adopting into an empty raster")
+    {
+        auto* memory = static_cast<glm::u8vec4*>(raster_memory::allocate(4096));
+        Raster<glm::u8vec4> raster(glm::uvec2(0, 0), raster_memory::UniqueBuffer<glm::u8vec4>(memory));
+        CHECK(raster.buffer_length() == 0);
+        // growing must not use (and free again) the buffer, that was freed already
+        raster.buffer().resize(2048);
+        CHECK(raster.buffer().data() != nullptr);
+    }
+    SECTION("reallocate keeps content")
+    {
+        auto* memory = static_cast<uint8_t*>(raster_memory::allocate(5000));
+        std::fill(memory, memory + 5000, uint8_t(7));
+        memory = static_cast<uint8_t*>(raster_memory::reallocate(memory, 9000));
+        CHECK(raster_memory::size(memory) == 9000);
+        CHECK(reinterpret_cast<uintptr_t>(memory) % raster_memory::alignment == 0);
+        CHECK(std::all_of(memory, memory + 5000, [](auto v) { return v == 7; }));
+        raster_memory::deallocate(memory);
+    }
+}
+
+TEST_CASE("nucleus/raster_memory benchmarks")
+{
+    BENCHMARK("Raster<u8vec4> 512 (pooled)") { return Raster<glm::u8vec4>(glm::uvec2(512)); };
+    BENCHMARK("std::vector<u8vec4> 512") { return std::vector<glm::u8vec4>(512 * 512); };
+}
+
+TEST_CASE("nucleus/Raster mipmap downsample")
+{
+    SECTION("u8vec4 equals reference")
+    {
+        for (const auto size : { 2u, 6u, 14u, 512u }) {
+            const auto src = random_raster<glm::u8vec4>(size);
+            Raster<glm::u8vec4> dst(src.size() / 2u);
+            nucleus::detail::downsample(src, dst);
+            CHECK(dst.buffer() == reference_downsample(src).buffer());
+        }
+    }
+    SECTION("uint16 equals reference")
+    {
+        for (const auto size : { 2u, 6u, 14u, 30u, 512u }) {
+            const auto src = random_raster<uint16_t>(size);
+            Raster<uint16_t> dst(src.size() / 2u);
+            nucleus::detail::downsample(src, dst);
+            CHECK(dst.buffer() == reference_downsample(src).buffer());
+        }
+        const auto src = Raster<uint16_t>(glm::uvec2(16), 65535);
+        Raster<uint16_t> dst(src.size() / 2u);
+        nucleus::detail::downsample(src, dst);
+        CHECK(dst.buffer() == reference_downsample(src).buffer());
+    }
+    SECTION("float is close to reference")
+    {
+        for (const auto size : { 2u, 6u, 512u }) {
+            const auto src = random_raster<float>(size);
+            Raster<float> dst(src.size() / 2u);
+            nucleus::detail::downsample(src, dst);
+            const auto reference = reference_downsample(src);
+            for (size_t i = 0; i < dst.buffer_length(); ++i)
+                CHECK(std::abs(dst.buffer()[i] - reference.buffer()[i]) < 0.001f);
+        }
+    }
+    SECTION("gamma correct")
+    {
+        Raster<glm::u8vec4> src(glm::uvec2(2), glm::u8vec4(0, 0, 0, 255));
+        src.pixel({ 1, 0 }) = glm::u8vec4(255, 255, 255, 0);
+        src.pixel({ 1, 1 }) = glm::u8vec4(255, 255, 255, 0);
+        const auto box = nucleus::generate_mipmap(src);
+        const auto srgb = nucleus::generate_mipmap(src, true);
+        REQUIRE(srgb.size() == 2);
+        CHECK(box[1].pixel({ 0, 0 }) == glm::u8vec4(127, 127, 127, 127));
+        // linear 0.5 is 0.735 in srgb, alpha is not gamma encoded
+        CHECK(srgb[1].pixel({ 0, 0 }) == glm::u8vec4(188, 188, 188, 127));
+
+        // uniform colours stay the same
+        const auto uniform = nucleus::generate_mipmap(Raster<glm::u8vec4>(glm::uvec2(4), glm::u8vec4(10, 100, 200, 50)), true);
+        CHECK(uniform.back().pixel({ 0, 0 }) == glm::u8vec4(10, 100, 200, 50));
+    }
+}
+
+TEST_CASE("nucleus/Raster mipmap benchmarks")
+{
+    const auto colour = random_raster<glm::u8vec4>(512);
+    const auto height = random_raster<uint16_t>(512);
+    const auto depth = random_raster<float>(512);
+    BENCHMARK("u8vec4 512 reference") { return reference_downsample(colour); };
+    BENCHMARK("u8vec4 512")
+    {
+        Raster<glm::u8vec4> dst(colour.size() / 2u);
+        nucleus::detail::downsample(colour, dst);
+        return dst;
+    };
+    BENCHMARK("u8vec4 512 gamma correct")
+    {
+        Raster<glm::u8vec4> dst(colour.size() / 2u);
+        nucleus::detail::downsample_srgb(colour, dst);
+        return dst;
+    };
+    BENCHMARK("uint16 512 reference") { return reference_downsample(height); };
+    BENCHMARK("uint16 512")
+    {
+        Raster<uint16_t> dst(height.size() / 2u);
+        nucleus::detail::downsample(height, dst);
+        return dst;
+    };
+    BENCHMARK("float 512 reference") { return reference_downsample(depth); };
+    BENCHMARK("float 512")
+    {
+        Raster<float> dst(depth.size() / 2u);
+        nucleus::detail::downsample(depth, dst);
+        return dst;
+    };
+    BENCHMARK("generate_mipmap u8vec4 512") { return nucleus::generate_mipmap(colour); };
+}
@@ -16,14 +16,17 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *****************************************************************************/
 
-#include <unordered_set>
+#include <algorithm>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 #include <catch2/catch_test_macros.hpp>
 #include <QStandardPaths>
 #include <QThread>
 
 #include "nucleus/tile/Cache.h"
+#include "nucleus/tile/DecodedTileCache.h"
 #include "radix/tile.h"
 
 using namespace nucleus::tile;
@@ -33,6 +36,11 @@ struct TestTile {
     Id id;
     std::string data;
 };
+struct SizedTestTile {
+    Id id;
+    uint64_t size = 0;
+    uint64_t size_in_bytes() const { return size; }
+};
 struct DiskWriteTestTileInner {
     Id id;
     std::shared_ptr<QByteArray> data;
@@ -146,6 +154,34 @@ TEST_CASE("nucleus/tile/cache")
         CHECK(visited.contains({ 1, { 1, 1 } }));
     }
 
+    SECTION("visit can run concurrently")
+    {
+        Cache<TestTile> cache;
+        cache.insert(TestTile { { 0, { 0, 0 } }, "root" });
+        for (const auto& id : Id { 0, { 0, 0 } }.children()) {
+            cache.insert(TestTile { id, "child" });
+            for (const auto& grand_child_id : id.children())
+                cache.insert(TestTile { grand_child_id, "grand child" });
+        }
+
+        std::vector<unsigned> n_visited(4, 0); // catch2 assertions are not thread safe
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < n_visited.size(); ++i) {
+            threads.emplace_back([&cache, &n_visited, i]() {
+                for (int j = 0; j < 100; ++j) {
+                    cache.visit([&n_visited, i](const TestTile&) {
+                        ++n_visited[i];
+                        return true;
+                    });
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        for (const auto n : n_visited)
+            CHECK(n == 100 * 21);
+    }
+
     SECTION("purge: all elements equal, large zoom levels first")
     {
         Cache<TestTile> cache;
@@ -252,6 +288,82 @@ TEST_CASE("nucleus/tile/cache")
         CHECK(cache.contains({ 1, { 0, 0 } }));
     }
 
+    SECTION("purge: byte budget")
+    {
+        Cache<SizedTestTile> cache;
+        cache.insert(SizedTestTile { { 2, { 0, 0 } }, 100 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 2, { 1, 0 } }, 100 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 2, { 2, 0 } }, 100 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 2, { 3, 0 } }, 100 });
+        CHECK(cache.n_cached_bytes() == 400);
+        cache.insert(SizedTestTile { { 2, { 3, 0 } }, 50 });
+        CHECK(cache.n_cached_bytes() == 350);
+
+        const auto purged = cache.purge(CacheBudget { .max_bytes = 250 });
+        CHECK(purged.size() == 1);
+        CHECK(cache.n_cached_bytes() == 250);
+        CHECK(!cache.contains({ 2, { 0, 0 } }));
+
+        cache.purge(CacheBudget { .max_objects = 1 });
+        CHECK(cache.n_cached_objects() == 1);
+        CHECK(cache.n_cached_bytes() == 50);
+        CHECK(cache.contains({ 2, { 3, 0 } }));
+    }
+
+    SECTION("purge: size weighted lru purges large objects earlier")
+    {
+        const auto fill = [](Cache<SizedTestTile>* cache) {
+            cache->insert(SizedTestTile { { 2, { 0, 0 } }, 10 });
+            QThread::msleep(2);
+            cache->insert(SizedTestTile { { 2, { 1, 0 } }, 1000 });
+            QThread::msleep(2);
+            cache->insert(SizedTestTile { { 2, { 2, 0 } }, 10 });
+        };
+        {
+            Cache<SizedTestTile> cache;
+            fill(&cache);
+            cache.purge(CacheBudget { .max_bytes = 100, .policy = EvictionPolicy::Lru });
+            CHECK(cache.n_cached_objects() == 1);
+            CHECK(cache.contains({ 2, { 2, 0 } }));
+        }
+        {
+            Cache<SizedTestTile> cache;
+            fill(&cache);
+            cache.purge(CacheBudget { .max_bytes = 100, .policy = EvictionPolicy::SizeWeightedLru });
+            CHECK(cache.n_cached_objects() == 2);
+            CHECK(cache.contains({ 2, { 0, 0 } }));
+            CHECK(!cache.contains({ 2, { 1, 0 } }));
+            CHECK(cache.contains({ 2, { 2, 0 } }));
+        }
+    }
+
+    SECTION("purge: size weighted lru keeps the ancestors of kept objects")
+    {
+        // the large parent would be purged first, but its small children are unreachable without it
+        Cache<SizedTestTile> cache;
+        cache.insert(SizedTestTile { { 0, { 0, 0 } }, 10 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 1, { 0, 0 } }, 1000 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 1, { 1, 1 } }, 100 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 2, { 0, 0 } }, 10 });
+        QThread::msleep(2);
+        cache.insert(SizedTestTile { { 2, { 1, 0 } }, 10 });
+
+        const auto purged = cache.purge(CacheBudget { .max_bytes = 1050, .policy = EvictionPolicy::SizeWeightedLru });
+        REQUIRE(purged.size() == 1);
+        CHECK(purged.front().id == Id { 1, { 1, 1 } });
+        CHECK(cache.contains({ 0, { 0, 0 } }));
+        CHECK(cache.contains({ 1, { 0, 0 } }));
+        CHECK(cache.contains({ 2, { 0, 0 } }));
+        CHECK(cache.contains({ 2, { 1, 0 } }));
+        CHECK(cache.n_cached_bytes() == 1030);
+    }
+
     SECTION("insert: insert overwrites existing objects")
     {
         Cache<TestTile> cache;
@@ -479,4 +591,253 @@ TEST_CASE("nucleus/tile/cache")
         }
         std::filesystem::remove_all(path);
     }
+
+    SECTION("disk cache is a single pack file, appended to with changed tiles and compacted") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        const auto pack_size = [&]() { return std::filesystem::file_size(path / "tiles.alp_pack"); };
+        {
+            Cache<DiskWriteTestTile> cache;
+            for (unsigned i = 0; i < 4; ++i)
+                cache.insert(create_test_tile({ i, { 0, 0 } }, 1));
+            CHECK(cache.write_to_disk(path).has_value());
+            const auto n_files = std::distance(std::filesystem::directory_iterator(path), std::filesystem::directory_iterator());
+            CHECK(n_files == 2);
+            const auto initial_size = pack_size();
+            CHECK(initial_size > 0);
+
+            // unchanged tiles are not written again
+            CHECK(cache.write_to_disk(path).has_value());
+            CHECK(pack_size() == initial_size);
+
+            // only the new tile is appended
+            cache.insert(create_test_tile({ 4, { 0, 0 } }, 1));
+            CHECK(cache.write_to_disk(path).has_value());
+            const auto size_with_5_tiles = pack_size();
+            CHECK(size_with_5_tiles > initial_size);
+            CHECK(size_with_5_tiles < initial_size * 2);
+
+            // updating tiles leaves dead bytes behind, which are compacted away eventually
+            for (int round = 2; round < 6; ++round) {
+                QThread::msleep(2);
+                for (unsigned i = 0; i < 5; ++i)
+                    cache.insert(create_test_tile({ i, { 0, 0 } }, round));
+                CHECK(cache.write_to_disk(path).has_value());
+                CHECK(pack_size() <= size_with_5_tiles * 2);
+            }
+        }
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(cache.read_from_disk(path).has_value());
+            CHECK(cache.n_cached_objects() == 5);
+            for (unsigned i = 0; i < 5; ++i)
+                verify_tile(cache, { i, { 0, 0 } }, 5);
+        }
+        std::filesystem::remove_all(path);
+    }
+
+    SECTION("reading disk cache back fails if the pack is truncated") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        {
+            Cache<DiskWriteTestTile> cache;
+            cache.insert(create_test_tile({ 0, { 0, 0 } }));
+            cache.insert(create_test_tile({ 1, { 0, 0 } }));
+            CHECK(cache.write_to_disk(path).has_value());
+        }
+        std::filesystem::resize_file(path / "tiles.alp_pack", std::filesystem::file_size(path / "tiles.alp_pack") / 2);
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(!cache.read_from_disk(path).has_value());
+            CHECK(cache.n_cached_objects() == 0);
+        }
+        std::filesystem::remove_all(path);
+    }
+
+    SECTION("reading disk cache back fails if the pack was replaced after the index was written") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        const auto other_path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache_2";
+        std::filesystem::remove_all(path);
+        std::filesystem::remove_all(other_path);
+        {
+            Cache<DiskWriteTestTile> cache;
+            cache.insert(create_test_tile({ 0, { 0, 0 } }));
+            cache.insert(create_test_tile({ 1, { 0, 0 } }));
+            CHECK(cache.write_to_disk(path).has_value());
+        }
+        {
+            // e.g., a crash during compaction. the other pack is larger and has the same layout, but a different generation
+            Cache<DiskWriteTestTile> cache;
+            cache.insert(create_test_tile({ 0, { 0, 0 } }));
+            cache.insert(create_test_tile({ 1, { 0, 0 } }));
+            cache.insert(create_test_tile({ 2, { 0, 0 } }));
+            CHECK(cache.write_to_disk(other_path).has_value());
+        }
+        std::filesystem::copy_file(other_path / "tiles.alp_pack", path / "tiles.alp_pack", std::filesystem::copy_options::overwrite_existing);
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(!cache.read_from_disk(path).has_value());
+            CHECK(cache.n_cached_objects() == 0);
+        }
+        std::filesystem::remove_all(path);
+        std::filesystem::remove_all(other_path);
+    }
+
+    SECTION("lazy reading from disk") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        {
+            Cache<DiskWriteTestTile> cache;
+            cache.insert(create_test_tile({ 0, { 0, 0 } }));
+            cache.insert(create_test_tile({ 1, { 0, 0 } }));
+            cache.insert(create_test_tile({ 1, { 1, 1 } }));
+            cache.insert(create_test_tile({ 2, { 0, 0 } }));
+            CHECK(cache.write_to_disk(path).has_value());
+        }
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(cache.read_from_disk(path, DiskReadMode::Lazy).has_value());
+            CHECK(cache.n_cached_objects() == 4);
+            CHECK(cache.contains({ 1, { 1, 1 } }));
+
+            std::unordered_set<Id, Id::Hasher> visited;
+            cache.visit([&visited](const DiskWriteTestTile& tile) {
+                CHECK(tile.n_children == 4);
+                visited.insert(tile.id);
+                return tile.id.zoom_level < 1;
+            });
+            CHECK(visited.size() == 3);
+            verify_tile(cache, { 2, { 0, 0 } });
+
+            // tiles that were never accessed are kept on disk
+            cache.insert(create_test_tile({ 3, { 0, 0 } }));
+            CHECK(cache.write_to_disk(path).has_value());
+        }
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(cache.read_from_disk(path, DiskReadMode::Lazy).has_value());
+            CHECK(cache.n_cached_objects() == 5);
+            verify_tile(cache, { 0, { 0, 0 } });
+            verify_tile(cache, { 1, { 0, 0 } });
+            verify_tile(cache, { 1, { 1, 1 } });
+            verify_tile(cache, { 2, { 0, 0 } });
+            verify_tile(cache, { 3, { 0, 0 } });
+        }
+        std::filesystem::remove_all(path);
+    }
+
+    SECTION("lazily read tiles survive a full write") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        const auto other_path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache_2";
+        std::filesystem::remove_all(path);
+        std::filesystem::remove_all(other_path);
+        {
+            Cache<DiskWriteTestTile> cache;
+            cache.insert(create_test_tile({ 0, { 0, 0 } }));
+            cache.insert(create_test_tile({ 1, { 0, 0 } }));
+            cache.insert(create_test_tile({ 2, { 0, 0 } }));
+            CHECK(cache.write_to_disk(path).has_value());
+        }
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(cache.read_from_disk(path, DiskReadMode::Lazy).has_value());
+            verify_tile(cache, { 1, { 0, 0 } });
+
+            // the pack is still mapped, the tiles that were never accessed are copied from there
+            std::filesystem::remove(path / "tiles.alp_pack");
+            CHECK(cache.write_to_disk(path).has_value());
+            CHECK(cache.write_to_disk(other_path).has_value());
+            verify_tile(cache, { 2, { 0, 0 } });
+        }
+        for (const auto& p : { path, other_path }) {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(cache.read_from_disk(p).has_value());
+            CHECK(cache.n_cached_objects() == 3);
+            verify_tile(cache, { 0, { 0, 0 } });
+            verify_tile(cache, { 1, { 0, 0 } });
+            verify_tile(cache, { 2, { 0, 0 } });
+        }
+        std::filesystem::remove_all(path);
+        std::filesystem::remove_all(other_path);
+    }
+
+    SECTION("writing to disk from another thread while the cache is in use") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        {
+            Cache<DiskWriteTestTile> cache;
+            for (unsigned i = 0; i < 10; ++i)
+                cache.insert(create_test_tile({ i, { 0, 0 } }));
+
+            std::vector<bool> results; // catch2 assertions are not thread safe
+            std::thread writer([&]() {
+                for (int i = 0; i < 5; ++i)
+                    results.push_back(cache.write_to_disk(path).has_value());
+            });
+            for (unsigned i = 10; i < 20; ++i) {
+                cache.insert(create_test_tile({ i, { 0, 0 } }));
+                cache.visit([](const DiskWriteTestTile&) { return true; });
+            }
+            writer.join();
+            CHECK(std::ranges::count(results, true) == 5);
+            CHECK(cache.write_to_disk(path).has_value());
+        }
+        {
+            Cache<DiskWriteTestTile> cache;
+            CHECK(cache.read_from_disk(path).has_value());
+            CHECK(cache.n_cached_objects() == 20);
+            for (unsigned i = 0; i < 20; ++i)
+                verify_tile(cache, { i, { 0, 0 } });
+        }
+        std::filesystem::remove_all(path);
+    }
+}
+
+TEST_CASE("nucleus/tile/decoded tile cache")
+{
+    using Payload = std::shared_ptr<const std::string>;
+    SECTION("hit, miss and stamp mismatch")
+    {
+        DecodedTileCache<Payload> cache(100);
+        CHECK(!cache.get({ 0, { 0, 0 } }, 1));
+        cache.put({ 0, { 0, 0 } }, 1, std::make_shared<const std::string>("a"), 10);
+        const auto payload = cache.get({ 0, { 0, 0 } }, 1);
+        REQUIRE(payload);
+        CHECK(*payload == "a");
+        CHECK(!cache.get({ 0, { 0, 0 } }, 2)); // refreshed source data
+        CHECK(cache.n_hits() == 1);
+        CHECK(cache.n_misses() == 2);
+        CHECK(cache.n_bytes() == 10);
+
+        cache.put({ 0, { 0, 0 } }, 2, std::make_shared<const std::string>("b"), 20);
+        CHECK(cache.size() == 1);
+        CHECK(cache.n_bytes() == 20);
+        CHECK(*cache.get({ 0, { 0, 0 } }, 2) == "b");
+    }
+    SECTION("least recently used entries are evicted when over the byte limit")
+    {
+        DecodedTileCache<Payload> cache(30);
+        cache.put({ 1, { 0, 0 } }, 0, std::make_shared<const std::string>("a"), 10);
+        cache.put({ 1, { 0, 1 } }, 0, std::make_shared<const std::string>("b"), 10);
+        cache.put({ 1, { 1, 0 } }, 0, std::make_shared<const std::string>("c"), 10);
+        CHECK(cache.get({ 1, { 0, 0 } }, 0)); // { 1, { 0, 1 } } is now least recently used
+        cache.put({ 1, { 1, 1 } }, 0, std::make_shared<const std::string>("d"), 10);
+        CHECK(cache.size() == 3);
+        CHECK(cache.n_bytes() == 30);
+        CHECK(!cache.get({ 1, { 0, 1 } }, 0));
+        CHECK(cache.get({ 1, { 0, 0 } }, 0));
+        CHECK(cache.get({ 1, { 1, 0 } }, 0));
+        CHECK(cache.get({ 1, { 1, 1 } }, 0));
+
+        cache.put({ 2, { 0, 0 } }, 0, std::make_shared<const std::string>("too large"), 31);
+        CHECK(!cache.get({ 2, { 0, 0 } }, 0));
+        CHECK(cache.size() == 3);
+
+        cache.set_byte_limit(10);
+        CHECK(cache.size() == 1);
+        CHECK(cache.n_bytes() == 10);
+        cache.clear();
+        CHECK(cache.size() == 0);
+        CHECK(cache.n_bytes() == 0);
+    }
 }
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "nucleus/tile/ConcurrencyController.h"
+
+using namespace nucleus::tile;
+
+namespace {
+// runs one window of requests with the given round trip time
+void run_window(ConcurrencyController& c, unsigned rtt, bool failed = false)
+{
+    std::vector<ConcurrencyController::Ticket> tickets;
+    while (c.can_start())
+        tickets.push_back(c.start());
+    for (const auto t : tickets)
+        c.finish(t, rtt, failed);
+}
+} // namespace
+
+TEST_CASE("nucleus/tile/concurrency controller")
+{
+    using Settings = ConcurrencyController::Settings;
+
+    SECTION("limits requests in flight")
+    {
+        ConcurrencyController c(Settings { .min_limit = 1, .max_limit = 10, .initial_limit = 3 });
+        CHECK(c.limit() == 3);
+        const auto a = c.start();
+        c.start();
+        c.start();
+        CHECK(!c.can_start());
+        CHECK(c.in_flight() == 3);
+        c.finish(a, 50, false);
+        CHECK(c.can_start());
+        CHECK(c.in_flight() == 2);
+    }
+
+    SECTION("grows additively on a fast link, up to the maximum")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 32, .initial_limit = 4 });
+        for (unsigned i = 0; i < 5; ++i)
+            run_window(c, 50);
+        CHECK(c.limit() > 4);
+        for (unsigned i = 0; i < 100; ++i)
+            run_window(c, 50);
+        CHECK(c.limit() == 32);
+        CHECK(c.smoothed_rtt() == 50);
+        CHECK(c.base_rtt() == 50);
+        CHECK(c.error_rate() == 0);
+    }
+
+    SECTION("doesn't grow when the window isn't used")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 32, .initial_limit = 4 });
+        for (unsigned i = 0; i < 20; ++i)
+            c.finish(c.start(), 50, false);
+        CHECK(c.limit() == 4);
+    }
+
+    SECTION("shrinks multiplicatively on errors, once per window")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 64, .initial_limit = 20, .decrease_factor = 0.5f });
+        run_window(c, 50, true);
+        CHECK(c.limit() == 10);
+        CHECK(c.error_rate() > 0.5f);
+        run_window(c, 50, true);
+        CHECK(c.limit() == 5);
+        for (unsigned i = 0; i < 10; ++i)
+            run_window(c, 50, true);
+        CHECK(c.limit() == 2);
+    }
+
+    SECTION("shrinks when round trips get slow (queueing, e.g., on mobile)")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 64, .initial_limit = 16, .latency_tolerance = 3.0f, .decrease_factor = 0.5f });
+        run_window(c, 100);
+        const auto limit = c.limit();
+        run_window(c, 250); // within tolerance
+        CHECK(c.limit() >= limit);
+        run_window(c, 1000);
+        CHECK(c.limit() < limit);
+        CHECK(c.error_rate() == 0);
+    }
+
+    SECTION("starts at the maximum by default")
+    {
+        ConcurrencyController c;
+        CHECK(c.limit() == ConcurrencyController::Settings {}.max_limit);
+    }
+
+    SECTION("replies without round trip neither grow nor shrink the window")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 32, .initial_limit = 4 });
+        for (unsigned i = 0; i < 20; ++i) {
+            std::vector<ConcurrencyController::Ticket> tickets;
+            while (c.can_start())
+                tickets.push_back(c.start());
+            for (const auto t : tickets)
+                c.finish(t, std::nullopt, false);
+        }
+        CHECK(c.limit() == 4);
+        CHECK(c.in_flight() == 0);
+        CHECK(c.smoothed_rtt() < 0);
+        CHECK(c.base_rtt() < 0);
+        CHECK(c.error_rate() == 0);
+    }
+
+    SECTION("base rtt forgets old minima")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 8, .initial_limit = 8, .base_rtt_window = 16 });
+        run_window(c, 20);
+        CHECK(c.base_rtt() == 20);
+        run_window(c, 50);
+        CHECK(c.base_rtt() == 20); // still within the previous window
+        for (unsigned i = 0; i < 8; ++i)
+            run_window(c, 50);
+        CHECK(c.base_rtt() == 50);
+    }
+
+    SECTION("recovers after congestion")
+    {
+        ConcurrencyController c(Settings { .min_limit = 2, .max_limit = 16, .initial_limit = 16 });
+        run_window(c, 50, true);
+        CHECK(c.limit() < 16);
+        for (unsigned i = 0; i < 100; ++i)
+            run_window(c, 50);
+        CHECK(c.limit() == 16);
+        CHECK(c.error_rate() < 0.01f);
+    }
+}
@@ -18,10 +18,12 @@
  *****************************************************************************/
 
 #include <QFile>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include "nucleus/tile/conversion.h"
 #include "nucleus/utils/image_loader.h"
+#include "test_helpers.h"
 
 namespace {
 auto check_alpine_raster_format_for(const glm::u8vec4& v)
@@ -112,4 +114,32 @@ TEST_CASE("nucleus/utils/tile_conversion")
         CHECK(u16_raster.buffer()[0] == 3744);
         CHECK(u16_raster.buffer()[1] == 3718);
     }
+
+    SECTION("byte array to raster unsigned short without rgba")
+    {
+        for (const auto& bytes : { test_helpers::load_test_file("test-tile.png"), test_helpers::black_png_tile(8), test_helpers::white_jpeg_tile(4) }) {
+            const auto direct = nucleus::utils::image_loader::rg8_as_u16(bytes);
+            REQUIRE(direct);
+            const auto reference = nucleus::tile::conversion::to_u16raster(nucleus::utils::image_loader::rgba8(bytes).value());
+            CHECK(direct->size() == reference.size());
+            CHECK(direct->buffer() == reference.buffer());
+        }
+        CHECK(!nucleus::utils::image_loader::rg8_as_u16(QByteArray("garbage")));
+    }
+}
+
+TEST_CASE("nucleus/utils/tile_conversion benchmarks")
+{
+    const auto height_tile = test_helpers::load_test_file("test-tile.png");
+    const auto ortho_tile = test_helpers::load_test_file("test-tile_ortho.jpeg");
+    const auto ortho_size = nucleus::utils::image_loader::rgba8(ortho_tile).value().size();
+
+    BENCHMARK("height png: rgba8 + to_u16raster") { return nucleus::tile::conversion::to_u16raster(nucleus::utils::image_loader::rgba8(height_tile).value()); };
+    BENCHMARK("height png: rg8_as_u16") { return nucleus::utils::image_loader::rg8_as_u16(height_tile); };
+    BENCHMARK("ortho jpeg: rgba8") { return nucleus::utils::image_loader::rgba8(ortho_tile); };
+    BENCHMARK_ADVANCED("ortho jpeg: rgba8_into a quadrant")(Catch::Benchmark::Chronometer meter)
+    {
+        nucleus::Raster<glm::u8vec4> quad(ortho_size * 2u);
+        meter.measure([&] { return nucleus::utils::image_loader::rgba8_into(ortho_tile, &quad.pixel(ortho_size), ortho_size, quad.width()); });
+    };
 }
@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2026 Adam Celarek
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+
+#include "nucleus/tile/LoadBalancer.h"
+
+using namespace nucleus::tile;
+
+TEST_CASE("nucleus/tile/load balancer")
+{
+    using Settings = LoadBalancer::Settings;
+    const uint64_t now = 1'000'000;
+
+    SECTION("healthy targets keep hash affinity")
+    {
+        LoadBalancer lb(4);
+        for (uint32_t hash = 0; hash < 1024; ++hash) {
+            const auto expected = unsigned((float(hash) / 1024.1f) * 4.0f);
+            CHECK(lb.select(hash, now) == expected);
+            CHECK(lb.select(hash + 1024, now) == expected);
+        }
+    }
+
+    SECTION("failing targets are ejected and their tiles spread over the others")
+    {
+        LoadBalancer lb(4, Settings { .max_error_rate = 0.3f, .ejection_msecs = 1000 });
+        for (unsigned i = 0; i < 4; ++i)
+            lb.report(0, 50, true, now);
+        CHECK(!lb.is_healthy(0, now));
+        CHECK(lb.is_healthy(1, now));
+
+        std::array<unsigned, 4> counts = {};
+        for (uint32_t hash = 0; hash < 256; ++hash) { // all of them belong to target 0 when healthy
+            const auto target = lb.select(hash, now);
+            CHECK(target == lb.select(hash, now)); // stable
+            ++counts[target];
+        }
+        CHECK(counts[0] == 0);
+        CHECK(counts[1] > 40);
+        CHECK(counts[2] > 40);
+        CHECK(counts[3] > 40);
+        // tiles of healthy targets stay
+        CHECK(lb.select(1000, now) == 3);
+
+        // comes back after the ejection
+        CHECK(lb.is_healthy(0, now + 1000));
+        CHECK(lb.select(0, now + 1000) == 0);
+        CHECK(lb.health(0).error_rate < 0.3f);
+    }
+
+    SECTION("slow targets are ejected, faster targets get more tiles")
+    {
+        LoadBalancer lb(3, Settings { .max_rtt_ratio = 4.0f, .min_samples = 4 });
+        for (unsigned i = 0; i < 10; ++i) {
+            lb.report(1, 50, false, now);
+            lb.report(2, 200, false, now);
+        }
+        CHECK(lb.is_healthy(0, now));
+        for (unsigned i = 0; i < 10; ++i)
+            lb.report(0, 1000, false, now);
+        CHECK(!lb.is_healthy(0, now));
+
+        std::array<unsigned, 3> counts = {};
+        for (uint32_t hash = 0; hash < 341; ++hash) // target 0
+            ++counts[lb.select(hash, now)];
+        CHECK(counts[0] == 0);
+        CHECK(counts[1] > 2 * counts[2]);
+    }
+
+    SECTION("retries avoid the failed target")
+    {
+        LoadBalancer lb(2);
+        CHECK(lb.select(0, now) == 0);
+        CHECK(lb.select(0, now, 0u) == 1);
+        CHECK(lb.select(1023, now, 1u) == 0);
+
+        LoadBalancer single(1);
+        CHECK(single.select(0, now, 0u) == 0);
+    }
+
+    SECTION("stays with the affine target, if everything is down")
+    {
+        LoadBalancer lb(2);
+        for (unsigned i = 0; i < 10; ++i) {
+            lb.report(0, 50, true, now);
+            lb.report(1, 50, true, now);
+        }
+        CHECK(!lb.is_healthy(0, now));
+        CHECK(!lb.is_healthy(1, now));
+        CHECK(lb.select(0, now) == 0);
+        CHECK(lb.select(1023, now) == 1);
+    }
+}
@@ -20,8 +20,13 @@
 
 #include <algorithm>
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QRegularExpression>
 #include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QUrl>
 #include <catch2/catch_test_macros.hpp>
 
 #include "nucleus/tile/TileLoadService.h"
@@ -239,4 +244,48 @@ TEST_CASE("nucleus/tile/TileLoadService")
         const auto image = QImage::fromData(*tile.data);
         REQUIRE(image.sizeInBytes() == 0);
     }
+
+    SECTION("requests are queued and sent as permitted by the concurrency controller")
+    {
+        // local files serve as a stub server
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+        TileLoadService service(QUrl::fromLocalFile(dir.path()).toString() + "/", TileLoadService::UrlPattern::ZXY, ".png");
+        REQUIRE(service.n_targets() == 1);
+
+        std::vector<Id> ids;
+        for (unsigned x = 0; x < 8; ++x) {
+            for (unsigned y = 0; y < 8; ++y)
+                ids.push_back(Id { .zoom_level = 6, .coords = { x, y } });
+        }
+        for (const auto& id : ids) {
+            if (id.coords.x == 0)
+                continue; // missing tiles
+            const auto path = QUrl(service.build_tile_url(id)).toLocalFile();
+            QDir().mkpath(QFileInfo(path).path());
+            QFile file(path);
+            REQUIRE(file.open(QIODeviceBase::WriteOnly));
+            file.write("tile");
+        }
+
+        QSignalSpy spy(&service, &TileLoadService::load_finished);
+        for (const auto& id : ids)
+            service.load(id);
+        CHECK(service.concurrency().in_flight() == service.concurrency().limit());
+        while (spy.count() < int(ids.size()) && spy.wait(2000)) { }
+
+        REQUIRE(spy.count() == int(ids.size()));
+        for (const auto& arguments : spy) {
+            const auto tile = arguments.at(0).value<TileLayer>();
+            if (tile.id.coords.x == 0) {
+                CHECK(tile.network_info.status == NetworkInfo::Status::NotFound);
+            } else {
+                CHECK(tile.network_info.status == NetworkInfo::Status::Good);
+                CHECK(*tile.data == "tile");
+            }
+        }
+        CHECK(service.concurrency().in_flight() == 0);
+        CHECK(service.concurrency().error_rate() == 0); // missing tiles are not errors
+        CHECK(service.concurrency().smoothed_rtt() >= 0);
+    }
 }
@@ -282,6 +282,22 @@ TEST_CASE("nucleus/tile/Scheduler")
         CHECK(std::find_if(quads.cbegin(), quads.cend(), [](const Id& id) { return id.zoom_level == 18; }) == quads.end());
     }
 
+    SECTION("quads are requested in order of screen space error (coarse to fine)")
+    {
+        auto scheduler = default_scheduler();
+        QSignalSpy spy(scheduler.get(), &Scheduler::quads_requested);
+        const auto camera = nucleus::camera::stored_positions::stephansdom();
+        scheduler->update_camera(camera);
+        scheduler->send_quad_requests();
+        REQUIRE(spy.size() == 1);
+        const auto quads = spy.constFirst().constFirst().value<std::vector<Id>>();
+        REQUIRE(quads.size() >= 5);
+        CHECK(quads.front() == Id { 0, { 0, 0 } });
+        const auto error = [&](const Id& id) { return nucleus::tile::utils::screen_space_error(camera, scheduler->aabb_decorator()->aabb(id), 256); };
+        for (size_t i = 1; i < quads.size(); ++i)
+            CHECK(error(quads[i - 1]) >= error(quads[i]));
+    }
+
     SECTION("quads are not requested if there is no network")
     {
         auto scheduler = default_scheduler();
@@ -580,6 +596,43 @@ TEST_CASE("nucleus/tile/Scheduler")
         CHECK(cached_tiles.contains({ 12, { 2234, 2675 } }));
     }
 
+    SECTION("progressive emission sends the same tiles in several batches, nearest first")
+    {
+        std::unordered_set<Id, Id::Hasher> batch_tiles;
+        std::unordered_set<Id, Id::Hasher> progressive_tiles;
+        {
+            auto scheduler = default_scheduler();
+            QSignalSpy spy(scheduler.get(), &TextureScheduler::gpu_tiles_updated);
+            for (const auto& q : example_quads_for_steffl_and_gg())
+                scheduler->receive_quad(q);
+            scheduler->update_camera(nucleus::camera::stored_positions::stephansdom());
+            scheduler->update_gpu_quads();
+            REQUIRE(spy.size() == 1);
+            for (const auto& tile : spy[0][1].value<std::vector<nucleus::tile::GpuTextureTile>>())
+                batch_tiles.insert(tile.id);
+        }
+        {
+            auto scheduler = default_scheduler();
+            scheduler->set_gpu_emit_interval(1);
+            QSignalSpy spy(scheduler.get(), &TextureScheduler::gpu_tiles_updated);
+            for (const auto& q : example_quads_for_steffl_and_gg())
+                scheduler->receive_quad(q);
+            scheduler->update_camera(nucleus::camera::stored_positions::stephansdom());
+            scheduler->update_gpu_quads();
+            REQUIRE(spy.size() >= 1);
+            for (const auto& signal : spy) {
+                for (const auto& tile : signal[1].value<std::vector<nucleus::tile::GpuTextureTile>>()) {
+                    CHECK(!progressive_tiles.contains(tile.id));
+                    progressive_tiles.insert(tile.id);
+                }
+            }
+            const auto first_batch = spy[0][1].value<std::vector<nucleus::tile::GpuTextureTile>>();
+            REQUIRE(!first_batch.empty());
+            CHECK(first_batch.front().id.zoom_level > 10); // a tile close to the camera, not the root
+        }
+        CHECK(progressive_tiles == batch_tiles);
+    }
+
     SECTION("ram tiles are purged")
     {
         auto scheduler = default_scheduler();
@@ -813,6 +866,21 @@ TEST_CASE("nucleus/tile/Scheduler benchmarks")
         scheduler->purge_ram_cache();
     };
 
+    {
+        auto scheduler = default_scheduler();
+        for (const auto& q : example_quads_many())
+            scheduler->receive_quad(q);
+        BENCHMARK("visit ram cache with " + std::to_string(scheduler->ram_cache().n_cached_objects()) + " quads")
+        {
+            unsigned n_visited = 0;
+            scheduler->ram_cache().visit([&n_visited](const DataQuad&) {
+                ++n_visited;
+                return true;
+            });
+            return n_visited;
+        };
+    }
+
     {
         auto scheduler = default_scheduler();
         scheduler->receive_quad({example_tile_quad_for({0, {0, 0}}),});
@@ -864,6 +932,42 @@ TEST_CASE("nucleus/tile/TextureScheduler")
         const auto qimage = nucleus::tile::conversion::to_QImage(joined);
         qimage.save("merged.png");
     }
+    SECTION("to_raster with missing and broken tiles")
+    {
+        nucleus::tile::DataQuad quad;
+        quad.id = radix::tile::Id { 6, { 34, 41 } };
+        const auto children = quad.id.children();
+        for (unsigned i = 0; i < 4; ++i) {
+            const auto& c = children[i];
+            quad.tiles[i].id = c;
+            quad.tiles[i].data = std::make_shared<QByteArray>();
+            quad.tiles[i].network_info = { NetworkInfo::Status::Good, 12345 };
+        }
+        const auto& decodable = quad.tiles[0];
+        *quad.tiles[0].data = test_helpers::load_test_file(QString("quad/%1_%2_%3.jpg").arg(decodable.id.zoom_level).arg(decodable.id.coords.x).arg(decodable.id.coords.y));
+        *quad.tiles[1].data = QByteArray("not an image");
+        quad.n_tiles = 4;
+
+        const auto white = glm::u8vec4 { 255, 255, 255, 255 };
+        const auto joined = TextureScheduler::to_raster(quad, { { 256, 256 }, white });
+        REQUIRE(joined.size() == glm::uvec2(512, 512));
+        const auto decoded = nucleus::utils::image_loader::rgba8(*decodable.data);
+        REQUIRE(decoded);
+
+        for (unsigned i = 0; i < 4; ++i) {
+            const auto position = quad_position(quad.tiles[i].id);
+            const auto offset = glm::uvec2(position == QuadPosition::TopRight || position == QuadPosition::BottomRight ? 256 : 0,
+                position == QuadPosition::BottomLeft || position == QuadPosition::BottomRight ? 256 : 0);
+            bool matches = true;
+            for (unsigned y = 0; y < 256; ++y) {
+                for (unsigned x = 0; x < 256; ++x) {
+                    const auto expected = i == 0 ? decoded->pixel({ x, y }) : white;
+                    matches = matches && joined.pixel(offset + glm::uvec2(x, y)) == expected;
+                }
+            }
+            CHECK(matches);
+        }
+    }
 }
 
 TEST_CASE("nucleus/tile/SchedulerDirector")
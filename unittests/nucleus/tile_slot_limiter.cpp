@@ -18,6 +18,7 @@
 
 #include <QSignalSpy>
 #include <QThread>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include "nucleus/tile/SlotLimiter.h"
@@ -192,4 +193,68 @@ TEST_CASE("nucleus/tile/slot limiter")
         REQUIRE(spy.size() == 2);
         CHECK(spy[1][0].value<DataQuad>().id == Id { 1, { 2, 3 } });
     }
+
+    SECTION("duplicate requests are coalesced")
+    {
+        SlotLimiter sl;
+        sl.set_limit(2);
+        QSignalSpy spy(&sl, &SlotLimiter::quad_requested);
+        sl.request_quads({ Id { 0, { 0, 0 } }, Id { 0, { 0, 0 } }, Id { 1, { 0, 0 } }, Id { 2, { 0, 0 } }, Id { 1, { 0, 0 } }, Id { 2, { 0, 0 } } });
+        CHECK(sl.slots_taken() == 2);
+        CHECK(sl.queue_size() == 1);
+        REQUIRE(spy.size() == 2);
+        CHECK(spy[1][0].value<Id>() == Id { 1, { 0, 0 } });
+
+        sl.deliver_quad(DataQuad { Id { 0, { 0, 0 } } });
+        sl.deliver_quad(DataQuad { Id { 1, { 0, 0 } } });
+        sl.deliver_quad(DataQuad { Id { 2, { 0, 0 } } });
+        REQUIRE(spy.size() == 3);
+        CHECK(spy[2][0].value<Id>() == Id { 2, { 0, 0 } });
+        CHECK(sl.slots_taken() == 0);
+    }
+
+    SECTION("queued quads, that are not requested anymore, are cancelled")
+    {
+        SlotLimiter sl;
+        sl.set_limit(1);
+        QSignalSpy spy(&sl, &SlotLimiter::quad_requested);
+        sl.request_quads({ Id { 0, { 0, 0 } }, Id { 1, { 0, 0 } }, Id { 1, { 0, 1 } } });
+        CHECK(sl.queue_size() == 2);
+        sl.request_quads({ Id { 0, { 0, 0 } }, Id { 1, { 1, 1 } } });
+        CHECK(sl.queue_size() == 1);
+
+        sl.deliver_quad(DataQuad { Id { 0, { 0, 0 } } });
+        sl.deliver_quad(DataQuad { Id { 1, { 1, 1 } } });
+        REQUIRE(spy.size() == 2);
+        CHECK(spy[1][0].value<Id>() == Id { 1, { 1, 1 } });
+        CHECK(sl.queue_size() == 0);
+    }
+}
+
+TEST_CASE("nucleus/tile/slot limiter benchmarks")
+{
+    std::vector<Id> ids;
+    for (unsigned y = 0; y < 128; ++y) {
+        for (unsigned x = 0; x < 128; ++x)
+            ids.push_back(Id { 14, { x, y } });
+    }
+
+    BENCHMARK("request and deliver " + std::to_string(ids.size()) + " quads")
+    {
+        SlotLimiter sl;
+        unsigned n_requested = 0;
+        QObject::connect(&sl, &SlotLimiter::quad_requested, [&n_requested](const Id&) { ++n_requested; });
+        sl.request_quads(ids);
+        for (const auto& id : ids)
+            sl.deliver_quad(DataQuad { id });
+        return n_requested;
+    };
+
+    BENCHMARK("re-request " + std::to_string(ids.size()) + " quads every tick")
+    {
+        SlotLimiter sl;
+        for (unsigned i = 0; i < 16; ++i)
+            sl.request_quads(ids);
+        return sl.queue_size();
+    };
 }
@@ -106,4 +106,25 @@ TEST_CASE("nucleus/vector_tiles")
 
         CHECK(all_ids.size() == 0);
     }
+    SECTION("Attributes")
+    {
+        using nucleus::vector_tile::PoiAttributes;
+        namespace attribute_keys = nucleus::vector_tile::attribute_keys;
+        PoiAttributes a;
+        a.insert("ele", "3798");
+        a.insert("shower", "yes");
+        a.insert("ele", "3799");
+        CHECK(a.size() == 2);
+        CHECK(a.contains("ele"));
+        CHECK(!a.contains("phone"));
+        CHECK(a["ele"] == "3799");
+        CHECK(a.value("shower") == "yes");
+        CHECK(a.value("never interned key").isEmpty());
+        CHECK(!attribute_keys::find("never interned key"));
+
+        PoiAttributes b;
+        b.insert("shower", "no");
+        CHECK(b.begin()->key == attribute_keys::intern("shower")); // keys are shared between attribute sets
+        CHECK(attribute_keys::name(b.begin()->key) == "shower");
+    }
 }
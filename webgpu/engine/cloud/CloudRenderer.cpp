@@ -476,6 +476,8 @@ void CloudRenderer::update_gpu_tiles_cloud(const std::vector<nucleus::tile::Id>&
         // test for validity
         assert(tile.id.zoom_level < 100);
         assert(tile.texture);
+        if (tile.texture->empty())
+            continue; // couldn't be decoded, see Texture3DScheduler::set_default_texture
 
         // Atlas is full
         if (m_loaded_cloud_textures.n_occupied() >= m_loaded_cloud_textures.size()) {